@@ -0,0 +1,504 @@
+#include "ColumnFile.hpp"
+
+#include "MappedFile.hpp"
+#include "RadixSort.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+const size_t column_chunk_size = sizeof(ColumnChunk);
+const size_t column_entry_size = sizeof(ColumnEntry);
+
+/* Codec */
+
+static void EncodeShuffleRle(
+    const uint32_t* values,
+    const size_t count,
+    std::vector<uint8_t>& out)
+{
+    // Neighbouring values share their high bytes, XOR leaves zeros there and
+    // the byte planes gather those zeros into long runs.
+    std::vector<uint8_t> planes(count * 4);
+    uint32_t previous = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint32_t x = values[i] ^ previous;
+        previous = values[i];
+
+        for (size_t p = 0; p < 4; p++)
+        {
+            planes[p * count + i] = static_cast<uint8_t>(x >> (24 - 8 * p));
+        }
+    }
+
+    // Control byte c < 128 is followed by c + 1 literals, otherwise it
+    // stands for c - 127 zeros.
+    out.clear();
+    size_t i = 0;
+
+    while (i < planes.size())
+    {
+        size_t zeros = 0;
+        while (i + zeros < planes.size() && planes[i + zeros] == 0 && zeros < 128)
+        {
+            zeros++;
+        }
+
+        if (zeros >= 2)
+        {
+            out.push_back(static_cast<uint8_t>(127 + zeros));
+            i += zeros;
+            continue;
+        }
+
+        size_t literals = 0;
+        while (i + literals < planes.size() && literals < 128)
+        {
+            const bool zero_run = i + literals + 1 < planes.size() &&
+                planes[i + literals] == 0 &&
+                planes[i + literals + 1] == 0;
+
+            if (zero_run)
+            {
+                break;
+            }
+            literals++;
+        }
+
+        out.push_back(static_cast<uint8_t>(literals - 1));
+        out.insert(out.end(), &planes[i], &planes[i] + literals);
+        i += literals;
+    }
+}
+
+static bool DecodeShuffleRle(
+    const uint8_t* data,
+    const size_t size,
+    const size_t count,
+    uint32_t* values,
+    std::vector<uint8_t>& planes)
+{
+    planes.resize(count * 4);
+
+    size_t i = 0;
+    for (size_t p = 0; p < size;)
+    {
+        const uint8_t c = data[p++];
+
+        if (c < 128)
+        {
+            const size_t literals = static_cast<size_t>(c) + 1;
+            if (p + literals > size || i + literals > planes.size())
+            {
+                return false;
+            }
+            std::memcpy(&planes[i], data + p, literals);
+            p += literals;
+            i += literals;
+        }
+        else
+        {
+            const size_t zeros = static_cast<size_t>(c) - 127;
+            if (i + zeros > planes.size())
+            {
+                return false;
+            }
+            std::memset(&planes[i], 0, zeros);
+            i += zeros;
+        }
+    }
+
+    if (i != planes.size())
+    {
+        return false;
+    }
+
+    uint32_t previous = 0;
+    for (size_t n = 0; n < count; n++)
+    {
+        uint32_t x = 0;
+        for (size_t p = 0; p < 4; p++)
+        {
+            x |= static_cast<uint32_t>(planes[p * count + n]) << (24 - 8 * p);
+        }
+        previous ^= x;
+        values[n] = previous;
+    }
+
+    return true;
+}
+
+/* Writer */
+
+bool WriteColumnFile(
+    const char* path,
+    const vec3* positions,
+    const size_t count,
+    const std::vector<std::vector<uint32_t>>& attributes,
+    const ColumnWriteOptions& options)
+{
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    if (options.spatial_order && count > 0)
+    {
+        vec3 min = positions[0];
+        vec3 max = positions[0];
+        for (size_t i = 1; i < count; i++)
+        {
+            min = glm::min(min, positions[i]);
+            max = glm::max(max, positions[i]);
+        }
+
+        const vec3 scale = 2097151.0f / glm::max(max - min, vec3(1e-30f));
+        std::vector<uint64_t> codes(count);
+
+        ResolveConcurrent([&](uint32_t start, uint32_t step)
+        {
+            for (size_t i = start; i < count; i += step)
+            {
+                const vec3 q = (positions[i] - min) * scale;
+                codes[i] =
+                    morton_spread(static_cast<uint64_t>(q.x)) |
+                    morton_spread(static_cast<uint64_t>(q.y)) << 1 |
+                    morton_spread(static_cast<uint64_t>(q.z)) << 2;
+            }
+        });
+
+        RadixSort(codes, order);
+    }
+
+    const uint32_t chunk_points = std::max<uint32_t>(options.chunk_points, 1);
+    const uint32_t chunk_count = static_cast<uint32_t>(
+        (count + chunk_points - 1) / chunk_points);
+    const uint32_t column_count = 3 + static_cast<uint32_t>(attributes.size());
+
+    std::vector<ColumnChunk> chunks(chunk_count);
+    // Encoded column data per chunk and column.
+    std::vector<std::vector<uint8_t>> blobs(chunk_count * column_count);
+    std::vector<uint32_t> codecs(chunk_count * column_count);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        std::vector<uint32_t> column(chunk_points);
+
+        for (uint32_t c = start; c < chunk_count; c += step)
+        {
+            const size_t i0 = static_cast<size_t>(c) * chunk_points;
+            const size_t n = std::min<size_t>(chunk_points, count - i0);
+
+            ColumnChunk& chunk = chunks[c];
+            chunk.point_count = static_cast<uint32_t>(n);
+
+            vec3 min = positions[order[i0]];
+            vec3 max = min;
+            for (size_t i = 0; i < n; i++)
+            {
+                min = glm::min(min, positions[order[i0 + i]]);
+                max = glm::max(max, positions[order[i0 + i]]);
+            }
+
+            for (int a = 0; a < 3; a++)
+            {
+                chunk.min[a] = min[a];
+                chunk.max[a] = max[a];
+            }
+
+            for (uint32_t col = 0; col < column_count; col++)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    const uint32_t index = order[i0 + i];
+                    if (col < 3)
+                    {
+                        std::memcpy(&column[i], &positions[index][col], 4);
+                    }
+                    else
+                    {
+                        column[i] = attributes[col - 3][index];
+                    }
+                }
+
+                std::vector<uint8_t>& blob = blobs[c * column_count + col];
+                uint32_t codec = COLUMN_RAW;
+
+                if (options.compress)
+                {
+                    EncodeShuffleRle(column.data(), n, blob);
+                    codec = blob.size() < n * 4 ? COLUMN_SHUFFLE_RLE : COLUMN_RAW;
+                }
+
+                if (codec == COLUMN_RAW)
+                {
+                    blob.resize(n * 4);
+                    std::memcpy(blob.data(), column.data(), n * 4);
+                }
+
+                codecs[c * column_count + col] = codec;
+            }
+        }
+    });
+
+    FILE* file = std::fopen(path, "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    ColumnFileHeader header;
+    std::memcpy(header.magic, "NNPC", 4);
+    header.version = column_file_version;
+    header.chunk_count = chunk_count;
+    header.attribute_count = static_cast<uint32_t>(attributes.size());
+    header.point_count = count;
+
+    // Directory, then column data in chunk order.
+    const size_t directory_entry =
+        column_chunk_size + column_count * column_entry_size;
+    std::vector<uint8_t> directory(chunk_count * directory_entry);
+    uint64_t offset = sizeof(ColumnFileHeader) + directory.size();
+
+    for (uint32_t c = 0; c < chunk_count; c++)
+    {
+        uint8_t* entry = &directory[c * directory_entry];
+        std::memcpy(entry, &chunks[c], column_chunk_size);
+
+        for (uint32_t col = 0; col < column_count; col++)
+        {
+            const std::vector<uint8_t>& blob = blobs[c * column_count + col];
+            const ColumnEntry column =
+            {
+                offset,
+                static_cast<uint32_t>(blob.size()),
+                codecs[c * column_count + col]
+            };
+            std::memcpy(
+                entry + column_chunk_size + col * column_entry_size,
+                &column,
+                column_entry_size);
+            offset += blob.size();
+        }
+    }
+
+    bool written =
+        std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(directory.data(), 1, directory.size(), file) ==
+            directory.size();
+
+    for (size_t b = 0; written && b < blobs.size(); b++)
+    {
+        written = std::fwrite(blobs[b].data(), 1, blobs[b].size(), file) ==
+            blobs[b].size();
+    }
+
+    written &= std::fclose(file) == 0;
+    return written;
+}
+
+/* Reader */
+
+bool LoadColumnFile(
+    const char* path,
+    Grid& grid,
+    const vec3 region_min,
+    const vec3 region_max,
+    std::vector<std::vector<uint32_t>>* attributes)
+{
+    MappedFile file(path);
+
+    if (!file.IsOpen() || file.Size() < sizeof(ColumnFileHeader))
+    {
+        return false;
+    }
+
+    ColumnFileHeader header;
+    std::memcpy(&header, file.Data(), sizeof(header));
+
+    if (std::memcmp(header.magic, "NNPC", 4) != 0 ||
+        header.version != column_file_version ||
+        header.attribute_count > std::numeric_limits<uint32_t>::max() - 3)
+    {
+        return false;
+    }
+
+    const uint32_t column_count = 3 + header.attribute_count;
+    const uint64_t directory_entry =
+        column_chunk_size + static_cast<uint64_t>(column_count) * column_entry_size;
+    const uint64_t directory_space = file.Size() - sizeof(header);
+
+    // Compared by division so corrupt counts cannot wrap the product, and
+    // at least one entry has to fit so the attribute count is bounded too.
+    if (directory_entry > directory_space ||
+        header.chunk_count > directory_space / directory_entry)
+    {
+        return false;
+    }
+
+    // Chunks overlapping the region, in file order.
+    std::vector<uint32_t> selected;
+    const uint8_t* directory = file.Data() + sizeof(header);
+    uint64_t point_total = 0;
+
+    for (uint32_t c = 0; c < header.chunk_count; c++)
+    {
+        ColumnChunk chunk;
+        std::memcpy(&chunk, directory + c * directory_entry, column_chunk_size);
+        point_total += chunk.point_count;
+
+        const bool overlaps =
+            chunk.min[0] <= region_max.x && chunk.max[0] >= region_min.x &&
+            chunk.min[1] <= region_max.y && chunk.max[1] >= region_min.y &&
+            chunk.min[2] <= region_max.z && chunk.max[2] >= region_min.z;
+
+        if (overlaps && chunk.point_count > 0)
+        {
+            selected.push_back(c);
+        }
+    }
+
+    if (point_total != header.point_count)
+    {
+        return false;
+    }
+
+    // Contiguous runs of chunks per worker keep file order across slices.
+    const uint32_t threads = concurrent_threads();
+    std::vector<GridSlice> slices(threads);
+    std::vector<std::vector<std::vector<uint32_t>>> slice_attributes(threads);
+    std::atomic<bool> valid(true);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        const size_t s0 = selected.size() * start / step;
+        const size_t s1 = selected.size() * (start + 1) / step;
+
+        GridSlice& slice = slices[start];
+        slice.histogram.assign(grid.bucket_count, 0);
+
+        std::vector<std::vector<uint32_t>>& kept = slice_attributes[start];
+        kept.resize(attributes ? header.attribute_count : 0);
+
+        std::vector<std::vector<uint32_t>> columns(column_count);
+        std::vector<uint8_t> planes;
+
+        for (size_t s = s0; s < s1 && valid; s++)
+        {
+            const uint8_t* entry = directory + selected[s] * directory_entry;
+
+            ColumnChunk chunk;
+            std::memcpy(&chunk, entry, column_chunk_size);
+
+            // Attribute columns are only decoded when asked for.
+            const uint32_t decode_count = attributes ? column_count : 3;
+
+            for (uint32_t col = 0; col < decode_count; col++)
+            {
+                ColumnEntry column;
+                std::memcpy(
+                    &column,
+                    entry + column_chunk_size + col * column_entry_size,
+                    column_entry_size);
+
+                const uint64_t value_bytes = static_cast<uint64_t>(chunk.point_count) * 4;
+
+                // A control byte expands to at most 128 bytes, so a column
+                // can not claim more values than its data could hold.
+                const bool in_file =
+                    column.offset <= file.Size() &&
+                    column.size <= file.Size() - column.offset;
+                const bool sized =
+                    column.codec == COLUMN_RAW ? value_bytes == column.size :
+                    column.codec == COLUMN_SHUFFLE_RLE ?
+                        value_bytes <= static_cast<uint64_t>(column.size) * 128 :
+                        false;
+
+                if (!in_file || !sized)
+                {
+                    valid = false;
+                    break;
+                }
+
+                std::vector<uint32_t>& values = columns[col];
+                values.resize(chunk.point_count);
+
+                const uint8_t* data = file.Data() + column.offset;
+
+                if (column.codec == COLUMN_SHUFFLE_RLE)
+                {
+                    valid = valid && DecodeShuffleRle(
+                        data,
+                        column.size,
+                        chunk.point_count,
+                        values.data(),
+                        planes);
+                }
+                else
+                {
+                    std::memcpy(values.data(), data, column.size);
+                }
+            }
+
+            if (!valid)
+            {
+                break;
+            }
+
+            for (uint32_t i = 0; i < chunk.point_count; i++)
+            {
+                vec3 position;
+                std::memcpy(&position.x, &columns[0][i], 4);
+                std::memcpy(&position.y, &columns[1][i], 4);
+                std::memcpy(&position.z, &columns[2][i], 4);
+
+                const bool inside =
+                    glm::all(glm::greaterThanEqual(position, region_min)) &&
+                    glm::all(glm::lessThanEqual(position, region_max));
+
+                if (!inside)
+                {
+                    continue;
+                }
+
+                const uint32_t bucket_id = grid.Bucket(position);
+                slice.positions.push_back(position);
+                slice.bucket_ids.push_back(bucket_id);
+                slice.histogram[bucket_id]++;
+
+                for (size_t a = 0; a < kept.size(); a++)
+                {
+                    kept[a].push_back(columns[3 + a][i]);
+                }
+            }
+        }
+    });
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    if (attributes)
+    {
+        attributes->assign(header.attribute_count, std::vector<uint32_t>());
+        for (auto& kept : slice_attributes)
+        {
+            for (size_t a = 0; a < kept.size(); a++)
+            {
+                (*attributes)[a].insert(
+                    (*attributes)[a].end(),
+                    kept[a].begin(),
+                    kept[a].end());
+            }
+        }
+    }
+
+    grid.Build(slices);
+    return true;
+}
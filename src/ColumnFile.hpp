@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Grid.hpp"
+
+/* Chunked columnar point file */
+
+// Layout, little endian:
+//   ColumnFileHeader
+//   ColumnChunk per chunk, each followed by a ColumnEntry per column
+//   column data
+// Columns are x, y, z as float then the uint32 attribute columns. Each chunk
+// stores its bounding box so readers can skip it without touching its data.
+
+const uint32_t column_file_version = 1;
+
+struct ColumnFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t chunk_count;
+    uint32_t attribute_count;
+    uint64_t point_count;
+};
+
+struct ColumnChunk
+{
+    uint32_t point_count;
+    float min[3];
+    float max[3];
+};
+
+enum ColumnCodec : uint32_t
+{
+    COLUMN_RAW = 0,
+    // XOR with the previous value, byte planes, zero runs collapsed.
+    COLUMN_SHUFFLE_RLE = 1
+};
+
+struct ColumnEntry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t codec;
+};
+
+struct ColumnWriteOptions
+{
+    uint32_t chunk_points = 65536;
+    bool compress = true;
+    // Reorder points along a Morton curve first so chunk bounds are tight.
+    // Attributes follow their points.
+    bool spatial_order = true;
+};
+
+// 'attributes' holds columns of 'count' values each.
+bool WriteColumnFile(
+    const char* path,
+    const vec3* positions,
+    const size_t count,
+    const std::vector<std::vector<uint32_t>>& attributes,
+    const ColumnWriteOptions& options = ColumnWriteOptions());
+
+// Builds 'grid' from the points inside [region_min, region_max]. Chunks whose
+// bounds miss the region are skipped, the rest are decoded in parallel. Grid
+// indices count kept points in file order, and 'attributes', when given,
+// receives their attribute columns in that order. Returns false when the
+// file could not be read.
+bool LoadColumnFile(
+    const char* path,
+    Grid& grid,
+    const vec3 region_min = vec3(-std::numeric_limits<float>::max()),
+    const vec3 region_max = vec3(std::numeric_limits<float>::max()),
+    std::vector<std::vector<uint32_t>>* attributes = nullptr);
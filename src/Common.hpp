@@ -0,0 +1,266 @@
+#pragma once
+
+#include "Worker.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_ENABLE_EXPERIMENTAL
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+
+using glm::vec3;
+
+/* Parameters */
+
+#define CONCURRENT
+#define NUM_BUCKETS 16384
+#define BUCKET_SIZE 0.5f
+
+/* Concurrency */
+
+// Worker count override, zero uses every hardware thread.
+inline std::atomic<uint32_t>& concurrent_threads_limit()
+{
+    static std::atomic<uint32_t> limit(0);
+    return limit;
+}
+
+inline uint32_t concurrent_threads()
+{
+#ifdef CONCURRENT
+    const uint32_t limit = concurrent_threads_limit();
+    const uint32_t threads = limit > 0 ?
+        limit : std::thread::hardware_concurrency();
+    return threads > 0 ? threads : 1;
+#else
+    return 1;
+#endif
+}
+
+// Runs job(start, step) on 'threads' workers and waits for all of them. For
+// repeated timed work prefer building a WorkerPool once, as main() does.
+template <typename Job>
+void ResolveConcurrent(const Job& job, const uint32_t threads)
+{
+#ifdef CONCURRENT
+    // A single worker runs on the calling thread, nothing to wake.
+    if (threads <= 1)
+    {
+        job(0, 1);
+        return;
+    }
+
+    WorkerPool workers;
+
+    for (uint32_t n = 0; n < threads; ++n)
+    {
+        workers.AddWorker(std::make_unique<Worker>([=, &job]
+        {
+            job(n, threads);
+        }));
+    }
+
+    workers.Resolve();
+#else
+    (void)threads;
+    job(0, 1);
+#endif
+}
+
+// On every worker.
+template <typename Job>
+void ResolveConcurrent(const Job& job)
+{
+    ResolveConcurrent(job, concurrent_threads());
+}
+
+/* Adaptive concurrency */
+
+// Nanoseconds to wake and join one worker, measured on first use. Call it
+// at startup to keep the measurement out of the first timed phase.
+inline float concurrent_worker_cost()
+{
+#ifdef CONCURRENT
+    static const float cost = []
+    {
+        const uint32_t threads = std::max(concurrent_threads(), 2u);
+        float best = std::numeric_limits<float>::max();
+
+        for (uint32_t r = 0; r < 5; r++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            ResolveConcurrent([](uint32_t, uint32_t) {}, threads);
+            const std::chrono::duration<float, std::nano> elapsed =
+                std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        return best / threads;
+    }();
+
+    return cost;
+#else
+    return 0.0f;
+#endif
+}
+
+// Per phase cost model. Picks how many workers a phase of 'items' should
+// use, from the worker cost and a running estimate of the phase's cost per
+// item, so small inputs run inline at single thread latency and large ones
+// use every worker. Keep one per call site, usually a static.
+class ConcurrentCost
+{
+    // Nanoseconds per item, on one thread.
+    std::atomic<float> item_cost_;
+
+public:
+    explicit ConcurrentCost(const float item_cost = 100.0f) :
+        item_cost_(item_cost)
+    {
+    }
+
+    uint32_t Threads(const size_t items) const
+    {
+        const uint32_t limit = concurrent_threads();
+        if (limit <= 1)
+        {
+            return 1;
+        }
+
+        // t workers take about t * worker + work / t, lowest at
+        // sqrt(work / worker), and must beat running inline.
+        const float work = static_cast<float>(items) * item_cost_.load(std::memory_order_relaxed);
+        const float worker = std::max(concurrent_worker_cost(), 1.0f);
+        const uint32_t threads = static_cast<uint32_t>(std::min<float>(
+            static_cast<float>(limit),
+            std::max(1.0f, std::round(std::sqrt(work / worker)))));
+
+        return threads > 1 && threads * worker + work / threads < work ?
+            threads : 1;
+    }
+
+    void Record(const size_t items, const uint32_t threads, const float elapsed)
+    {
+        if (items == 0)
+        {
+            return;
+        }
+
+        const float overhead = threads > 1 ? threads * concurrent_worker_cost() : 0.0f;
+        const float measured =
+            std::max(elapsed - overhead, 0.0f) * threads / static_cast<float>(items);
+
+        // Smoothed, a racing update only loses one sample.
+        const float previous = item_cost_.load(std::memory_order_relaxed);
+        item_cost_.store(previous * 0.75f + measured * 0.25f, std::memory_order_relaxed);
+    }
+};
+
+// ResolveConcurrent over 'items' with as many workers as 'cost' picks,
+// timing the run to refine its estimate.
+template <typename Job>
+void ResolveConcurrent(const Job& job, ConcurrentCost& cost, const size_t items)
+{
+    const uint32_t threads = cost.Threads(items);
+
+    const auto start = std::chrono::steady_clock::now();
+    ResolveConcurrent(job, threads);
+    const std::chrono::duration<float, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    cost.Record(items, threads, elapsed.count());
+}
+
+/* Cancellation */
+
+// Stop flag with an optional deadline, polled by long batches between
+// chunks. Cancel and SetDeadline may be called from any thread.
+class CancelToken
+{
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<bool> cancelled_;
+    // Clock ticks, max when there is no deadline.
+    std::atomic<clock::rep> deadline_;
+
+public:
+    CancelToken() :
+        cancelled_(false),
+        deadline_(std::numeric_limits<clock::rep>::max())
+    {
+    }
+
+    void Cancel()
+    {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    void SetDeadline(const clock::time_point deadline)
+    {
+        deadline_.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    void SetTimeout(const clock::duration timeout)
+    {
+        SetDeadline(clock::now() + timeout);
+    }
+
+    bool Stopped() const
+    {
+        return cancelled_.load(std::memory_order_relaxed) ||
+            clock::now().time_since_epoch().count() >=
+            deadline_.load(std::memory_order_relaxed);
+    }
+};
+
+// Items per cancellation check, well under a millisecond of searching.
+const size_t cancel_chunk_items = 1024;
+
+// ResolveConcurrent over [0, count) as chunks claimed in order by the
+// workers. Each chunk runs job(i0, i1), or skip(i0, i1) once 'token' has
+// stopped, so a stopped batch releases its workers within a chunk. Returns
+// false if any chunk was skipped, 'token' may be null.
+template <typename Job, typename Skip>
+bool ResolveCancellable(
+    const Job& job,
+    const Skip& skip,
+    const size_t count,
+    const CancelToken* token,
+    ConcurrentCost& cost)
+{
+    std::atomic<size_t> next(0);
+    std::atomic<bool> stopped(false);
+
+    ResolveConcurrent([&](uint32_t, uint32_t)
+    {
+        while (true)
+        {
+            const size_t i0 = next.fetch_add(cancel_chunk_items);
+            if (i0 >= count)
+            {
+                return;
+            }
+
+            const size_t i1 = std::min(count, i0 + cancel_chunk_items);
+
+            if (token && (stopped.load(std::memory_order_relaxed) || token->Stopped()))
+            {
+                stopped.store(true, std::memory_order_relaxed);
+                skip(i0, i1);
+            }
+            else
+            {
+                job(i0, i1);
+            }
+        }
+    }, cost, count);
+
+    return !stopped;
+}
@@ -0,0 +1,139 @@
+#include "Geodetic.hpp"
+
+void GeodeticToUnit(
+    const double* latitude,
+    const double* longitude,
+    const size_t count,
+    vec3* unit)
+{
+    const double to_radians = 3.14159265358979323846 / 180.0;
+    static ConcurrentCost cost(30.0f);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        // Contiguous slices, so workers do not write to the same cache
+        // lines of 'unit'.
+        const size_t slice = (count + step - 1) / step;
+        const size_t i0 = std::min(count, slice * start);
+        const size_t i1 = std::min(count, i0 + slice);
+
+        for (size_t i = i0; i < i1; i++)
+        {
+            const double lat = latitude[i] * to_radians;
+            const double lon = longitude[i] * to_radians;
+            const double cos_lat = std::cos(lat);
+
+            unit[i] = vec3(
+                static_cast<float>(cos_lat * std::cos(lon)),
+                static_cast<float>(cos_lat * std::sin(lon)),
+                static_cast<float>(std::sin(lat)));
+        }
+    }, cost, count);
+}
+
+Grid GeodeticGrid(const double max_distance, const size_t count)
+{
+    const float cell_size = meters_to_chord(max_distance) * 2.0f;
+
+    return Grid(
+        cell_size,
+        fib_calc_bucket_count(count),
+        geodetic_bounds(cell_size));
+}
+
+void GeodeticSearch(
+    const GridView& grid,
+    const vec3* queries,
+    const size_t count,
+    uint32_t* nearest,
+    float* meters)
+{
+    const float radius = grid.cell_size * 0.5f;
+    const float radius2 = radius * radius;
+    static ConcurrentCost cost(200.0f);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t i = start; i < count; i += step)
+        {
+            const vec3 p0 = queries[i];
+
+            uint32_t buckets[8];
+            const uint32_t bucket_count = grid.NeighbourBuckets(p0, buckets);
+
+            // Squared chord, compared without any trigonometry.
+            float nearest_chord2 = radius2;
+            uint32_t nearest_index = std::numeric_limits<uint32_t>::max();
+
+            for (uint32_t j = 0; j < bucket_count; j++)
+            {
+                const uint32_t k0 = grid.buckets_start[buckets[j]];
+                const uint32_t k1 = grid.buckets_start[buckets[j] + 1];
+
+                for (uint32_t k = k0; k < k1; k++)
+                {
+                    const vec3 d = grid.positions[k] - p0;
+                    const float chord2 = glm::dot(d, d);
+                    if (chord2 <= nearest_chord2)
+                    {
+                        nearest_chord2 = chord2;
+                        nearest_index = grid.indices[k];
+                    }
+                }
+            }
+
+            nearest[i] = nearest_index;
+            meters[i] = std::sqrt(nearest_chord2);
+        }
+
+        // Converted in a separate pass so the search loop stays free of
+        // transcendental calls.
+        for (size_t i = start; i < count; i += step)
+        {
+            meters[i] = nearest[i] == std::numeric_limits<uint32_t>::max() ?
+                std::numeric_limits<float>::max() :
+                chord_to_meters(meters[i]);
+        }
+    }, cost, count);
+}
+
+JoinResult GeodeticJoin(
+    const double* left_latitude,
+    const double* left_longitude,
+    const size_t left_count,
+    const double* right_latitude,
+    const double* right_longitude,
+    const size_t right_count,
+    const JoinOptions& options,
+    const JoinConsumer& consumer)
+{
+    std::vector<vec3> left(left_count);
+    std::vector<vec3> right(right_count);
+
+    GeodeticToUnit(left_latitude, left_longitude, left_count, left.data());
+    GeodeticToUnit(right_latitude, right_longitude, right_count, right.data());
+
+    JoinOptions chord_options = options;
+    chord_options.distance = meters_to_chord(options.distance);
+    // SpatialJoin hashes with cells of twice the distance.
+    chord_options.bounds = geodetic_bounds(chord_options.distance * 2.0f);
+
+    // Consumer calls are serialized, so one scratch buffer is enough.
+    std::vector<JoinPair> converted;
+
+    return SpatialJoin(
+        left.data(),
+        left_count,
+        right.data(),
+        right_count,
+        chord_options,
+        [&](const JoinPair* pairs, size_t count)
+        {
+            converted.assign(pairs, pairs + count);
+            for (auto& pair : converted)
+            {
+                pair.distance = chord_to_meters(pair.distance);
+            }
+            consumer(converted.data(), count);
+        });
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Grid.hpp"
+#include "Join.hpp"
+
+/* Geodetic */
+
+// Latitude/longitude in degrees are mapped to ECEF on the unit sphere, where
+// the chord between two points is monotonic in their great-circle distance.
+// Distances are great-circle meters on a sphere of the WGS84 mean radius, so
+// they are within ~0.5% of ellipsoidal geodesics. Float positions on the unit
+// sphere resolve to roughly a meter.
+
+const double earth_radius = 6371008.8;
+
+// Shifts the unit sphere into [cell_size, 2 + cell_size] before hashing.
+// The half-cell neighbour hash steps one cell below a position's own, so the
+// extra cell keeps that cell non negative at the edge of the sphere.
+inline vec3 geodetic_bounds(const float cell_size)
+{
+    return vec3(1.0f + cell_size);
+}
+
+inline float meters_to_chord(const double meters)
+{
+    return static_cast<float>(2.0 * std::sin(meters / (2.0 * earth_radius)));
+}
+
+inline float chord_to_meters(const float chord)
+{
+    const float half = std::min(chord * 0.5f, 1.0f);
+    return static_cast<float>(2.0 * earth_radius * std::asin(half));
+}
+
+void GeodeticToUnit(
+    const double* latitude,
+    const double* longitude,
+    const size_t count,
+    vec3* unit);
+
+// Grid over unit sphere positions for searches up to 'max_distance' meters.
+Grid GeodeticGrid(const double max_distance, const size_t count);
+
+// For each query finds the nearest point of 'grid' (built from
+// GeodeticToUnit positions) within the grid's search radius. 'nearest' is
+// the input index or UINT32_MAX when none was found, 'meters' is the
+// great-circle distance.
+void GeodeticSearch(
+    const GridView& grid,
+    const vec3* queries,
+    const size_t count,
+    uint32_t* nearest,
+    float* meters);
+
+// SpatialJoin over latitude/longitude, 'options.distance' is in meters and
+// so are the distances handed to 'consumer'.
+JoinResult GeodeticJoin(
+    const double* left_latitude,
+    const double* left_longitude,
+    const size_t left_count,
+    const double* right_latitude,
+    const double* right_longitude,
+    const size_t right_count,
+    const JoinOptions& options,
+    const JoinConsumer& consumer);
@@ -0,0 +1,646 @@
+#include "Grid.hpp"
+
+#include "RadixSort.hpp"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Batched search */
+
+const uint32_t batch_width = 8;
+// Smaller groups waste too many lanes, search those one by one.
+const uint32_t batch_min_queries = 4;
+
+struct BatchQuery
+{
+    std::array<uint32_t, 8> buckets;
+    uint32_t index;
+};
+
+// One candidate at a time against every lane, with the lanes held in
+// vector registers for the whole run of candidates.
+static inline void NearestLanes(
+    const GridView& grid,
+    const uint32_t k0,
+    const uint32_t k1,
+    const float* qx,
+    const float* qy,
+    const float* qz,
+    const uint32_t* self,
+    float* best,
+    uint32_t* best_index)
+{
+#if defined(__SSE2__)
+    static_assert(batch_width == 8, "lanes are two SSE registers");
+
+    __m128 vx[2], vy[2], vz[2], vbest[2];
+    __m128i vself[2], vindex[2];
+
+    for (uint32_t h = 0; h < 2; h++)
+    {
+        vx[h] = _mm_loadu_ps(qx + h * 4);
+        vy[h] = _mm_loadu_ps(qy + h * 4);
+        vz[h] = _mm_loadu_ps(qz + h * 4);
+        vbest[h] = _mm_loadu_ps(best + h * 4);
+        vself[h] = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(self + h * 4));
+        vindex[h] = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(best_index + h * 4));
+    }
+
+    for (uint32_t k = k0; k < k1; k++)
+    {
+        const vec3 c = grid.positions[k];
+        const __m128 cx = _mm_set1_ps(c.x);
+        const __m128 cy = _mm_set1_ps(c.y);
+        const __m128 cz = _mm_set1_ps(c.z);
+        const __m128i vk = _mm_set1_epi32(static_cast<int32_t>(k));
+
+        for (uint32_t h = 0; h < 2; h++)
+        {
+            const __m128 dx = _mm_sub_ps(cx, vx[h]);
+            const __m128 dy = _mm_sub_ps(cy, vy[h]);
+            const __m128 dz = _mm_sub_ps(cz, vz[h]);
+            const __m128 d2 = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                _mm_mul_ps(dz, dz));
+
+            const __m128 is_self = _mm_castsi128_ps(
+                _mm_cmpeq_epi32(vk, vself[h]));
+            const __m128 better = _mm_andnot_ps(
+                is_self,
+                _mm_cmplt_ps(d2, vbest[h]));
+            const __m128i better_i = _mm_castps_si128(better);
+
+            vbest[h] = _mm_or_ps(
+                _mm_and_ps(better, d2),
+                _mm_andnot_ps(better, vbest[h]));
+            vindex[h] = _mm_or_si128(
+                _mm_and_si128(better_i, vk),
+                _mm_andnot_si128(better_i, vindex[h]));
+        }
+    }
+
+    for (uint32_t h = 0; h < 2; h++)
+    {
+        _mm_storeu_ps(best + h * 4, vbest[h]);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(best_index + h * 4),
+            vindex[h]);
+    }
+#else
+    for (uint32_t k = k0; k < k1; k++)
+    {
+        const vec3 c = grid.positions[k];
+
+        for (uint32_t l = 0; l < batch_width; l++)
+        {
+            const float dx = c.x - qx[l];
+            const float dy = c.y - qy[l];
+            const float dz = c.z - qz[l];
+            const float d2 = dx * dx + dy * dy + dz * dz;
+            const bool better = (d2 < best[l]) & (k != self[l]);
+            best[l] = better ? d2 : best[l];
+            best_index[l] = better ? k : best_index[l];
+        }
+    }
+#endif
+}
+
+static void NearestBatch(
+    const GridView& grid,
+    const BatchQuery* queries,
+    const uint32_t count,
+    Nearest* results)
+{
+    float qx[batch_width];
+    float qy[batch_width];
+    float qz[batch_width];
+    float best[batch_width];
+    uint32_t self[batch_width];
+    uint32_t best_index[batch_width];
+
+    // Unused lanes repeat the first query and are discarded.
+    for (uint32_t l = 0; l < batch_width; l++)
+    {
+        const uint32_t i = queries[l < count ? l : 0].index;
+        const vec3 p = grid.positions[i];
+        qx[l] = p.x;
+        qy[l] = p.y;
+        qz[l] = p.z;
+        best[l] = std::numeric_limits<float>::max();
+        self[l] = i;
+        best_index[l] = i;
+    }
+
+    // Distinct buckets, each with the per lane squared distance to the
+    // nearest of its cells, see Grid::OrderedNeighbourBuckets.
+    uint32_t buckets[8];
+    float bounds2[8][batch_width];
+    uint32_t bucket_count = 0;
+
+    for (uint32_t j = 0; j < 8; j++)
+    {
+        const vec3 offset = hash_bucket_offsets[j];
+
+        uint32_t m = 0;
+        while (m < bucket_count && buckets[m] != queries[0].buckets[j])
+        {
+            m++;
+        }
+
+        if (m == bucket_count)
+        {
+            buckets[bucket_count++] = queries[0].buckets[j];
+            for (uint32_t l = 0; l < batch_width; l++)
+            {
+                bounds2[m][l] = std::numeric_limits<float>::max();
+            }
+        }
+
+        for (uint32_t l = 0; l < batch_width; l++)
+        {
+            const vec3 p0 = (vec3(qx[l], qy[l], qz[l]) + grid.bounds) /
+                grid.cell_size;
+            const vec3 t = vec3(
+                fract2(p0.x) < 0.5f ? fract2(p0.x) : fract2(p0.x) - 1.0f,
+                fract2(p0.y) < 0.5f ? fract2(p0.y) : fract2(p0.y) - 1.0f,
+                fract2(p0.z) < 0.5f ? fract2(p0.z) : fract2(p0.z) - 1.0f);
+            const vec3 d = glm::mix(
+                glm::max(t, vec3(0.0f)),
+                glm::max(-t, vec3(0.0f)),
+                offset) * grid.cell_size;
+            bounds2[m][l] = std::min(bounds2[m][l], glm::dot(d, d));
+        }
+    }
+
+    // Nearest buckets first so the best distances shrink early.
+    uint32_t order[8];
+    float order_bound2[8];
+    for (uint32_t m = 0; m < bucket_count; m++)
+    {
+        const float bound2 = *std::min_element(
+            bounds2[m],
+            bounds2[m] + batch_width);
+
+        uint32_t n = m;
+        while (n > 0 && order_bound2[n - 1] > bound2)
+        {
+            order[n] = order[n - 1];
+            order_bound2[n] = order_bound2[n - 1];
+            n--;
+        }
+        order[n] = m;
+        order_bound2[n] = bound2;
+    }
+
+    for (uint32_t o = 0; o < bucket_count; o++)
+    {
+        const uint32_t m = order[o];
+
+        // Skip buckets that cannot improve any lane.
+        uint32_t mask = 0;
+        for (uint32_t l = 0; l < batch_width; l++)
+        {
+            mask |= static_cast<uint32_t>(bounds2[m][l] < best[l]);
+        }
+
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        const uint32_t k0 = grid.buckets_start[buckets[m]];
+        const uint32_t k1 = grid.buckets_start[buckets[m] + 1];
+
+        NearestLanes(grid, k0, k1, qx, qy, qz, self, best, best_index);
+    }
+
+    for (uint32_t l = 0; l < count; l++)
+    {
+        Nearest& nearest = results[self[l]];
+        nearest.found = best_index[l] != self[l];
+        nearest.index = best_index[l];
+        nearest.distance = nearest.found ?
+            std::sqrt(best[l]) :
+            std::numeric_limits<float>::max();
+        nearest.candidates = 0;
+    }
+}
+
+void BatchedNearest(const GridView& grid, const uint32_t bucket, Nearest* results)
+{
+    const uint32_t i0 = grid.buckets_start[bucket];
+    const uint32_t i1 = grid.buckets_start[bucket + 1];
+
+    if (i0 == i1)
+    {
+        return;
+    }
+
+    // Group points of the bucket by their neighbour buckets, collisions
+    // mean points sharing a bucket need not share a cell.
+    thread_local std::vector<BatchQuery> queries;
+    queries.resize(i1 - i0);
+
+    for (uint32_t i = i0; i < i1; i++)
+    {
+        BatchQuery& query = queries[i - i0];
+        query.index = i;
+        for (uint32_t j = 0; j < 8; j++)
+        {
+            query.buckets[j] = grid.Bucket(
+                grid.positions[i],
+                hash_bucket_offsets[j]);
+        }
+    }
+
+    std::sort(queries.begin(), queries.end(),
+        [](const BatchQuery& a, const BatchQuery& b)
+        {
+            return a.buckets < b.buckets;
+        });
+
+    uint32_t first = 0;
+    const uint32_t count = i1 - i0;
+
+    while (first < count)
+    {
+        uint32_t last = first + 1;
+        while (last < count &&
+               last - first < batch_width &&
+               queries[last].buckets == queries[first].buckets)
+        {
+            last++;
+        }
+
+        if (last - first >= batch_min_queries)
+        {
+            NearestBatch(grid, &queries[first], last - first, results);
+        }
+        else
+        {
+            for (uint32_t q = first; q < last; q++)
+            {
+                const uint32_t i = queries[q].index;
+                results[i] = grid.FindNearest(grid.positions[i], i);
+            }
+        }
+
+        first = last;
+    }
+}
+
+template <typename Index>
+BasicGrid<Index>::BasicGrid(
+    const float cell_size,
+    const uint32_t bucket_count,
+    const vec3 bounds) :
+    BasicGridView<Index>(cell_size, bucket_count, bounds)
+{
+}
+
+template <typename Index>
+BasicGrid<Index>::BasicGrid(const BasicGrid& other) :
+    BasicGridView<Index>(other),
+    positions_(other.positions_),
+    indices_(other.indices_),
+    buckets_start_(other.buckets_start_),
+    bucket_ids(other.bucket_ids)
+{
+    Rebind();
+}
+
+template <typename Index>
+BasicGrid<Index>::BasicGrid(BasicGrid&& other) :
+    BasicGridView<Index>(other),
+    positions_(std::move(other.positions_)),
+    indices_(std::move(other.indices_)),
+    buckets_start_(std::move(other.buckets_start_)),
+    bucket_ids(std::move(other.bucket_ids))
+{
+    Rebind();
+    other.Rebind();
+}
+
+template <typename Index>
+BasicGrid<Index>& BasicGrid<Index>::operator=(const BasicGrid& other)
+{
+    BasicGridView<Index>::operator=(other);
+    positions_ = other.positions_;
+    indices_ = other.indices_;
+    buckets_start_ = other.buckets_start_;
+    bucket_ids = other.bucket_ids;
+    Rebind();
+    return *this;
+}
+
+template <typename Index>
+BasicGrid<Index>& BasicGrid<Index>::operator=(BasicGrid&& other)
+{
+    BasicGridView<Index>::operator=(other);
+    positions_ = std::move(other.positions_);
+    indices_ = std::move(other.indices_);
+    buckets_start_ = std::move(other.buckets_start_);
+    bucket_ids = std::move(other.bucket_ids);
+    Rebind();
+    other.Rebind();
+    return *this;
+}
+
+template <typename Index>
+void BasicGrid<Index>::Rebind()
+{
+    this->point_count = positions_.size();
+    this->positions = positions_.data();
+    this->indices = indices_.data();
+    this->buckets_start = buckets_start_.empty() ? nullptr : buckets_start_.data();
+}
+
+template <typename Index>
+void BasicGrid<Index>::Build(const vec3* input, const size_t count)
+{
+    BuildFrom(input, count);
+}
+
+template <typename Index>
+void BasicGrid<Index>::Build(const StridedPositions& input, const size_t count)
+{
+    BuildFrom(input, count);
+}
+
+template <typename Index>
+template <typename Input>
+void BasicGrid<Index>::BuildFrom(const Input& input, const size_t count)
+{
+    const uint32_t bucket_count = this->bucket_count;
+    std::vector<uint32_t> input_bucket_ids(count);
+
+    positions_.resize(count);
+    bucket_ids.resize(count);
+    indices_.resize(count);
+    buckets_start_.assign(bucket_count + 1, 0);
+
+    // Sort points by buckets using O(n) sort.
+    // This part can be done in parallel using atomics, and would be on the GPU.
+    // But on the CPU gains are not enormous for reasonable sizes of clouds.
+    for (size_t i = 0; i < count; i++)
+    {
+        input_bucket_ids[i] = this->Bucket(input[i]);
+        buckets_start_[input_bucket_ids[i] + 1]++;
+    }
+
+    for (uint32_t i = 1; i <= bucket_count; i++)
+    {
+        buckets_start_[i] += buckets_start_[i - 1];
+    }
+
+    // Scatter backwards through the end offsets so they end up as the
+    // start offsets, keeping input order within each bucket.
+    std::vector<Index> buckets_end(
+        buckets_start_.begin() + 1,
+        buckets_start_.end());
+
+    for (size_t i = count; i-- > 0;)
+    {
+        const uint32_t bucket_id = input_bucket_ids[i];
+        const Index k = --buckets_end[bucket_id];
+        positions_[k] = input[i];
+        bucket_ids[k] = bucket_id;
+        indices_[k] = static_cast<Index>(i);
+    }
+
+    Rebind();
+}
+
+template <typename Index>
+void BasicGrid<Index>::BuildRadix(const vec3* input, const size_t count)
+{
+    const uint32_t bucket_count = this->bucket_count;
+    const uint32_t cell_bits = this->bucket_shift + 32;
+    const uint64_t cell_mask = cell_bits >= 64 ? ~0ull : (1ull << cell_bits) - 1;
+
+    std::vector<uint64_t> keys(count);
+    std::vector<Index> order(count);
+
+    static ConcurrentCost key_cost(10.0f);
+    static ConcurrentCost gather_cost(10.0f);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t i = start; i < count; i += step)
+        {
+            const vec3 p = (input[i] + this->bounds) / this->cell_size;
+            const uint64_t cell =
+                morton_spread(static_cast<uint32_t>(p.x)) |
+                morton_spread(static_cast<uint32_t>(p.y)) << 1 |
+                morton_spread(static_cast<uint32_t>(p.z)) << 2;
+            const uint64_t bucket = this->Bucket(input[i]);
+
+            keys[i] = (cell_bits >= 64 ? 0 : bucket << cell_bits) | (cell & cell_mask);
+            order[i] = static_cast<Index>(i);
+        }
+    }, key_cost, count);
+
+    RadixSort(keys, order);
+
+    // Sorted keys are read only from here on, so any worker may look at
+    // its neighbour's points through them.
+    const auto sorted_bucket = [&](const size_t k)
+    {
+        return static_cast<uint32_t>(cell_bits >= 64 ? 0 : keys[k] >> cell_bits);
+    };
+
+    positions_.resize(count);
+    bucket_ids.resize(count);
+    buckets_start_.resize(bucket_count + 1);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        // Contiguous slices so each bucket start is written by one worker.
+        const size_t slice = (count + step - 1) / step;
+        const size_t k0 = std::min(count, slice * start);
+        const size_t k1 = std::min(count, k0 + slice);
+
+        for (size_t k = k0; k < k1; k++)
+        {
+            positions_[k] = input[order[k]];
+            bucket_ids[k] = sorted_bucket(k);
+        }
+
+        // Buckets starting at k are those after the previous point's.
+        for (size_t k = k0; k < k1; k++)
+        {
+            const uint32_t first = k == 0 ? 0 : sorted_bucket(k - 1) + 1;
+            for (uint32_t b = first; b <= bucket_ids[k]; b++)
+            {
+                buckets_start_[b] = static_cast<Index>(k);
+            }
+        }
+    }, gather_cost, count);
+
+    for (uint32_t b = count == 0 ? 0 : sorted_bucket(count - 1) + 1; b <= bucket_count; b++)
+    {
+        buckets_start_[b] = static_cast<Index>(count);
+    }
+
+    indices_ = std::move(order);
+    Rebind();
+}
+
+template <typename Index>
+void BasicGrid<Index>::Build(const std::vector<GridSlice>& slices)
+{
+    std::vector<std::vector<Index>> slice_offsets = Allocate(slices);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t t = start; t < slices.size(); t += step)
+        {
+            ScatterSlice(slices, t, slice_offsets[t]);
+        }
+    });
+}
+
+template <typename Index>
+std::vector<std::vector<Index>> BasicGrid<Index>::Allocate(
+    const std::vector<GridSlice>& slices)
+{
+    const uint32_t bucket_count = this->bucket_count;
+
+    size_t count = 0;
+    for (auto& slice : slices)
+    {
+        count += slice.bucket_ids.size();
+    }
+
+    positions_.resize(count);
+    bucket_ids.resize(count);
+    indices_.resize(count);
+    buckets_start_.assign(bucket_count + 1, 0);
+
+    // Offset of each slice within each bucket, slices in input order.
+    std::vector<std::vector<Index>> slice_offsets(
+        slices.size(),
+        std::vector<Index>(bucket_count));
+
+    Index offset = 0;
+    for (uint32_t b = 0; b < bucket_count; b++)
+    {
+        buckets_start_[b] = offset;
+        for (size_t t = 0; t < slices.size(); t++)
+        {
+            slice_offsets[t][b] = offset;
+            offset += slices[t].histogram[b];
+        }
+    }
+    buckets_start_[bucket_count] = offset;
+
+    Rebind();
+    return slice_offsets;
+}
+
+template <typename Index>
+void BasicGrid<Index>::ScatterSlice(
+    const std::vector<GridSlice>& slices,
+    const size_t t,
+    std::vector<Index>& offsets)
+{
+    Index base = 0;
+    for (size_t n = 0; n < t; n++)
+    {
+        base += static_cast<Index>(slices[n].positions.size());
+    }
+
+    const GridSlice& slice = slices[t];
+
+    for (size_t i = 0; i < slice.positions.size(); i++)
+    {
+        const uint32_t bucket_id = slice.bucket_ids[i];
+        const Index k = offsets[bucket_id]++;
+        positions_[k] = slice.positions[i];
+        bucket_ids[k] = bucket_id;
+        indices_[k] = base + static_cast<Index>(i);
+    }
+}
+
+template <typename Index>
+void BasicGrid<Index>::ScatterRange(
+    const vec3* input,
+    const std::vector<GridSlice>& slices,
+    const size_t t,
+    const size_t i0,
+    const size_t i1,
+    std::vector<Index>& offsets)
+{
+    Index base = 0;
+    for (size_t n = 0; n < t; n++)
+    {
+        base += static_cast<Index>(slices[n].bucket_ids.size());
+    }
+
+    const GridSlice& slice = slices[t];
+
+    for (size_t i = i0; i < i1; i++)
+    {
+        const uint32_t bucket_id = slice.bucket_ids[i];
+        const Index k = offsets[bucket_id]++;
+        positions_[k] = input[base + i];
+        bucket_ids[k] = bucket_id;
+        indices_[k] = base + static_cast<Index>(i);
+    }
+}
+
+template <typename Index>
+void BasicGrid<Index>::Assign(
+    std::vector<vec3>&& sorted_positions,
+    std::vector<uint32_t>&& sorted_bucket_ids,
+    std::vector<Index>&& sorted_indices,
+    std::vector<Index>&& sorted_buckets_start)
+{
+    positions_ = std::move(sorted_positions);
+    bucket_ids = std::move(sorted_bucket_ids);
+    indices_ = std::move(sorted_indices);
+    buckets_start_ = std::move(sorted_buckets_start);
+    Rebind();
+}
+
+template class BasicGrid<uint32_t>;
+template class BasicGrid<uint64_t>;
+
+template <typename Index>
+void AnyWithinSearch(
+    const BasicGridView<Index>& grid,
+    const vec3* queries,
+    const size_t count,
+    const float radius,
+    uint8_t* hits)
+{
+    static ConcurrentCost cost(100.0f);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t i = start; i < count; i += step)
+        {
+            hits[i] = grid.AnyWithin(queries[i], radius) ? 1 : 0;
+        }
+    }, cost, count);
+}
+
+template void AnyWithinSearch(
+    const GridView& grid,
+    const vec3* queries,
+    const size_t count,
+    const float radius,
+    uint8_t* hits);
+
+template void AnyWithinSearch(
+    const GridView64& grid,
+    const vec3* queries,
+    const size_t count,
+    const float radius,
+    uint8_t* hits);
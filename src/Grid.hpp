@@ -0,0 +1,421 @@
+#pragma once
+
+#include "Hash.hpp"
+
+#include <vector>
+
+/* Grid */
+
+// Points already hashed by one loader thread, in input order. 'histogram'
+// counts points per bucket of the grid they will be built into. Slices for
+// ScatterRange leave 'positions' empty, the points stay in caller memory.
+struct GridSlice
+{
+    std::vector<vec3> positions;
+    std::vector<uint32_t> bucket_ids;
+    std::vector<uint32_t> histogram;
+};
+
+// Positions read in place from caller memory. Each component advances by
+// 'stride' bytes per point, covering interleaved records as well as separate
+// x, y and z arrays.
+struct StridedPositions
+{
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* z = nullptr;
+    size_t stride = sizeof(float);
+
+    StridedPositions() = default;
+
+    StridedPositions(const float* x, const float* y, const float* z, const size_t stride) :
+        x(x), y(y), z(z), stride(stride)
+    {
+    }
+
+    vec3 operator[](const size_t i) const
+    {
+        const size_t offset = i * stride;
+        return vec3(
+            *reinterpret_cast<const float*>(reinterpret_cast<const char*>(x) + offset),
+            *reinterpret_cast<const float*>(reinterpret_cast<const char*>(y) + offset),
+            *reinterpret_cast<const float*>(reinterpret_cast<const char*>(z) + offset));
+    }
+};
+
+struct SearchOptions
+{
+    // Accept a neighbour up to (1 + epsilon) times farther than the true
+    // nearest within half a cell. Zero is exact and still skips buckets
+    // whose cell cannot hold anything closer.
+    float epsilon = 0.0f;
+    // Stop after this many distance evaluations.
+    uint32_t max_candidates = std::numeric_limits<uint32_t>::max();
+};
+
+template <typename Index>
+struct BasicNearest
+{
+    bool found = false;
+    Index index = 0;
+    float distance = std::numeric_limits<float>::max();
+    uint32_t candidates = 0;
+};
+
+// Points counting sorted by fib hashed cell. The 8 half-cell neighbour
+// buckets of a position cover every point within 'cell_size / 2' of it, so
+// for a fixed radius search build with a cell size of twice the radius.
+//
+// GridView holds the queries over sorted data it does not own, Grid builds
+// and owns that data.
+//
+// 'Index' is the type of point indices and offsets. Clouds of up to 2^32 - 1
+// points use the uint32_t GridView and Grid. Larger ones need GridView64 and
+// Grid64, which cost 4 more bytes per point and per bucket.
+
+template <typename Index>
+class BasicGridView
+{
+public:
+    float cell_size;
+    // Added before hashing so coordinates are positive, keep it close to
+    // the cloud's extent as it costs float precision.
+    vec3 bounds;
+    uint32_t bucket_count;
+    uint32_t bucket_shift;
+
+    size_t point_count = 0;
+    // Sorted by bucket id.
+    const vec3* positions = nullptr;
+    // Input index of each sorted point.
+    const Index* indices = nullptr;
+    // Points of bucket b are [buckets_start[b], buckets_start[b + 1]).
+    const Index* buckets_start = nullptr;
+
+    BasicGridView(
+        const float cell_size = BUCKET_SIZE,
+        const uint32_t bucket_count = NUM_BUCKETS,
+        const vec3 bounds = hash_bounds) :
+        cell_size(cell_size),
+        bounds(bounds),
+        bucket_count(bucket_count),
+        bucket_shift(fib_calc_bucket_shift(bucket_count))
+    {
+    }
+
+    size_t Size() const
+    {
+        return point_count;
+    }
+
+    uint32_t Bucket(const vec3 pos) const
+    {
+        return fib_hash_to_index(
+            hash(pos, cell_size, bounds),
+            bucket_shift);
+    }
+
+    uint32_t Bucket(const vec3 pos, const vec3 offset) const
+    {
+        return fib_hash_to_index(
+            hash(pos, offset, cell_size, bounds),
+            bucket_shift);
+    }
+
+    // Writes the distinct buckets among the 8 neighbours of 'pos', different
+    // cells may share a bucket. Returns how many were written.
+    uint32_t NeighbourBuckets(const vec3 pos, uint32_t buckets[8]) const
+    {
+        uint32_t count = 0;
+        for (uint32_t j = 0; j < 8; j++)
+        {
+            const uint32_t bucket = Bucket(pos, hash_bucket_offsets[j]);
+
+            bool seen = false;
+            for (uint32_t n = 0; n < count; n++)
+            {
+                seen |= buckets[n] == bucket;
+            }
+
+            if (!seen)
+            {
+                buckets[count++] = bucket;
+            }
+        }
+        return count;
+    }
+
+    // As NeighbourBuckets, ordered by the squared distance from 'pos' to the
+    // nearest cell mapping to each bucket, written to 'bounds2'.
+    uint32_t OrderedNeighbourBuckets(
+        const vec3 pos,
+        uint32_t buckets[8],
+        float bounds2[8]) const
+    {
+        // Offset of 'pos' from the corner shared by the 8 cells, in cells.
+        const vec3 p0 = (pos + bounds) / cell_size;
+        const vec3 t = vec3(
+            fract2(p0.x) < 0.5f ? fract2(p0.x) : fract2(p0.x) - 1.0f,
+            fract2(p0.y) < 0.5f ? fract2(p0.y) : fract2(p0.y) - 1.0f,
+            fract2(p0.z) < 0.5f ? fract2(p0.z) : fract2(p0.z) - 1.0f);
+
+        const vec3 below = glm::max(t, vec3(0.0f)) * cell_size;
+        const vec3 above = glm::max(-t, vec3(0.0f)) * cell_size;
+
+        uint32_t count = 0;
+        for (uint32_t j = 0; j < 8; j++)
+        {
+            const vec3 offset = hash_bucket_offsets[j];
+            const uint32_t bucket = Bucket(pos, offset);
+            const vec3 d = glm::mix(below, above, offset);
+            const float bound2 = glm::dot(d, d);
+
+            // Keep the smaller bound of buckets shared between cells.
+            uint32_t n = 0;
+            while (n < count && buckets[n] != bucket)
+            {
+                n++;
+            }
+
+            if (n < count)
+            {
+                if (bound2 >= bounds2[n])
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                count++;
+            }
+
+            // Insertion sort into place.
+            while (n > 0 && bounds2[n - 1] > bound2)
+            {
+                buckets[n] = buckets[n - 1];
+                bounds2[n] = bounds2[n - 1];
+                n--;
+            }
+
+            buckets[n] = bucket;
+            bounds2[n] = bound2;
+        }
+        return count;
+    }
+
+    // Nearest point to 'pos' other than sorted index 'exclude'. Exact for
+    // neighbours within 'cell_size / 2', farther ones are found only when
+    // they share a bucket.
+    BasicNearest<Index> FindNearest(
+        const vec3 pos,
+        const Index exclude,
+        const SearchOptions& options = SearchOptions()) const
+    {
+        BasicNearest<Index> nearest;
+
+        uint32_t buckets[8];
+        float bounds2[8];
+        const uint32_t bucket_count =
+            OrderedNeighbourBuckets(pos, buckets, bounds2);
+
+        const float slack = (1.0f + options.epsilon) * (1.0f + options.epsilon);
+        float nearest_distance2 = std::numeric_limits<float>::max();
+
+        for (uint32_t j = 0; j < bucket_count; j++)
+        {
+            // Later buckets are farther still.
+            if (bounds2[j] * slack >= nearest_distance2)
+            {
+                break;
+            }
+
+            const Index k0 = buckets_start[buckets[j]];
+            const Index k1 = k0 + std::min<Index>(
+                buckets_start[buckets[j] + 1] - k0,
+                options.max_candidates - nearest.candidates);
+
+            for (Index k = k0; k < k1; k++)
+            {
+                const vec3 d = positions[k] - pos;
+                const float d2 = glm::dot(d, d);
+                if (d2 < nearest_distance2 && k != exclude)
+                {
+                    nearest_distance2 = d2;
+                    nearest.index = k;
+                    nearest.found = true;
+                }
+            }
+
+            nearest.candidates += static_cast<uint32_t>(k1 - k0);
+
+            if (nearest.candidates >= options.max_candidates)
+            {
+                break;
+            }
+        }
+
+        if (nearest.found)
+        {
+            nearest.distance = std::sqrt(nearest_distance2);
+        }
+        return nearest;
+    }
+
+    // True if some point other than sorted index 'exclude' lies within
+    // 'radius' of 'pos', exact for a radius up to 'cell_size / 2'. Starts
+    // with the bucket of the cell holding 'pos' and returns on the first hit.
+    bool AnyWithin(
+        const vec3 pos,
+        const float radius,
+        const Index exclude = std::numeric_limits<Index>::max()) const
+    {
+        uint32_t buckets[8];
+        float bounds2[8];
+        const uint32_t bucket_count =
+            OrderedNeighbourBuckets(pos, buckets, bounds2);
+
+        const float radius2 = radius * radius;
+
+        for (uint32_t j = 0; j < bucket_count; j++)
+        {
+            if (bounds2[j] > radius2)
+            {
+                break;
+            }
+
+            const Index k1 = buckets_start[buckets[j] + 1];
+            Index k = buckets_start[buckets[j]];
+
+            // Blocks are tested without branches so the compares vectorize
+            // and only the combined mask is checked.
+            for (; k + 8 <= k1; k += 8)
+            {
+                uint32_t mask = 0;
+                for (Index n = 0; n < 8; n++)
+                {
+                    const vec3 d = positions[k + n] - pos;
+                    mask |= static_cast<uint32_t>(glm::dot(d, d) <= radius2) &
+                        static_cast<uint32_t>(k + n != exclude);
+                }
+
+                if (mask != 0)
+                {
+                    return true;
+                }
+            }
+
+            for (; k < k1; k++)
+            {
+                const vec3 d = positions[k] - pos;
+                if (glm::dot(d, d) <= radius2 && k != exclude)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+};
+
+using GridView = BasicGridView<uint32_t>;
+using GridView64 = BasicGridView<uint64_t>;
+using Nearest = BasicNearest<uint32_t>;
+using Nearest64 = BasicNearest<uint64_t>;
+
+template <typename Index>
+class BasicGrid : public BasicGridView<Index>
+{
+private:
+    std::vector<vec3> positions_;
+    std::vector<Index> indices_;
+    std::vector<Index> buckets_start_;
+
+    // Points the view at the owned vectors.
+    void Rebind();
+
+    template <typename Input>
+    void BuildFrom(const Input& input, const size_t count);
+
+public:
+    // Bucket id of each sorted point.
+    std::vector<uint32_t> bucket_ids;
+
+    BasicGrid(
+        const float cell_size = BUCKET_SIZE,
+        const uint32_t bucket_count = NUM_BUCKETS,
+        const vec3 bounds = hash_bounds);
+
+    BasicGrid(const BasicGrid& other);
+    BasicGrid(BasicGrid&& other);
+    BasicGrid& operator=(const BasicGrid& other);
+    BasicGrid& operator=(BasicGrid&& other);
+
+    void Build(const vec3* input, const size_t count);
+
+    // Hashes and scatters straight from caller memory, with no packed copy
+    // of the input.
+    void Build(const StridedPositions& input, const size_t count);
+
+    // Same grid through a parallel radix sort on 64 bit keys of bucket id
+    // then cell Morton code, so points of a bucket are also grouped by cell
+    // along a Morton curve. Slower to build than the counting sort, see
+    // nnsearch_scaling.
+    void BuildRadix(const vec3* input, const size_t count);
+
+    // Input order is the slices concatenated. Scatters each slice in
+    // parallel from the per slice histograms, without hashing again.
+    void Build(const std::vector<GridSlice>& slices);
+
+    // Build(slices) in two steps, for callers scheduling the scatter
+    // themselves. Allocate sizes the grid from the slice histograms and
+    // returns each slice's write offsets per bucket, ScatterSlice then
+    // writes slice 't' and may run concurrently for different slices.
+    std::vector<std::vector<Index>> Allocate(const std::vector<GridSlice>& slices);
+
+    void ScatterSlice(
+        const std::vector<GridSlice>& slices,
+        const size_t t,
+        std::vector<Index>& offsets);
+
+    // ScatterSlice for slices hashed from 'input' in place, writing points
+    // [i0, i1) of slice 't', counted from the slice's start. Ranges of one
+    // slice must be written in order, one at a time.
+    void ScatterRange(
+        const vec3* input,
+        const std::vector<GridSlice>& slices,
+        const size_t t,
+        const size_t i0,
+        const size_t i1,
+        std::vector<Index>& offsets);
+
+    // Takes over data already in bucket order, as decoded from a file.
+    void Assign(
+        std::vector<vec3>&& sorted_positions,
+        std::vector<uint32_t>&& sorted_bucket_ids,
+        std::vector<Index>&& sorted_indices,
+        std::vector<Index>&& sorted_buckets_start);
+};
+
+// Defined in Grid.cpp for both index types.
+extern template class BasicGrid<uint32_t>;
+extern template class BasicGrid<uint64_t>;
+
+using Grid = BasicGrid<uint32_t>;
+using Grid64 = BasicGrid<uint64_t>;
+
+// Nearest neighbour of every point of 'bucket', written to results[i] for
+// sorted index i. Queries with the same 8 neighbour buckets are grouped and
+// evaluated together against each candidate, keeping per query best
+// distances in lanes. Exact as FindNearest with the default options.
+void BatchedNearest(const GridView& grid, const uint32_t bucket, Nearest* results);
+
+// Sets hits[i] to whether any point of 'grid' lies within 'radius' of
+// queries[i], see Grid::AnyWithin. Defined for both index types.
+template <typename Index>
+void AnyWithinSearch(
+    const BasicGridView<Index>& grid,
+    const vec3* queries,
+    const size_t count,
+    const float radius,
+    uint8_t* hits);
@@ -0,0 +1,304 @@
+#include "GridFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+static uint64_t align_up(const uint64_t offset)
+{
+    return (offset + grid_file_alignment - 1) / grid_file_alignment *
+        grid_file_alignment;
+}
+
+GridFileHeader MakeGridFileHeader(const GridView& grid)
+{
+    GridFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "NNGF", 4);
+    header.version = grid_file_version;
+    header.cell_size = grid.cell_size;
+    header.bounds[0] = grid.bounds.x;
+    header.bounds[1] = grid.bounds.y;
+    header.bounds[2] = grid.bounds.z;
+    header.bucket_count = grid.bucket_count;
+    header.point_count = grid.Size();
+
+    header.buckets_offset = align_up(sizeof(header));
+    header.positions_offset = align_up(
+        header.buckets_offset + (grid.bucket_count + 1) * sizeof(uint32_t));
+    header.indices_offset = align_up(
+        header.positions_offset + grid.Size() * sizeof(vec3));
+    return header;
+}
+
+bool ValidGridFileHeader(const GridFileHeader& header, const uint64_t size)
+{
+    // Offsets and counts come from the file, compare by division and
+    // subtraction so none of them can wrap.
+    const auto fits = [size](uint64_t offset, uint64_t count, uint64_t element)
+    {
+        return offset <= size && count <= (size - offset) / element;
+    };
+
+    return
+        std::memcmp(header.magic, "NNGF", 4) == 0 &&
+        header.version == grid_file_version &&
+        header.bucket_count > 1 &&
+        (header.bucket_count & (header.bucket_count - 1)) == 0 &&
+        header.point_count <= std::numeric_limits<uint32_t>::max() &&
+        fits(
+            header.buckets_offset,
+            static_cast<uint64_t>(header.bucket_count) + 1,
+            sizeof(uint32_t)) &&
+        fits(header.positions_offset, header.point_count, sizeof(vec3)) &&
+        fits(header.indices_offset, header.point_count, sizeof(uint32_t));
+}
+
+bool ValidGridBuckets(
+    const uint32_t* buckets_start,
+    const uint32_t bucket_count,
+    const uint64_t point_count)
+{
+    for (uint32_t b = 0; b < bucket_count; b++)
+    {
+        if (buckets_start[b] > buckets_start[b + 1])
+        {
+            return false;
+        }
+    }
+    return buckets_start[bucket_count] <= point_count;
+}
+
+uint64_t GridFileSize(const GridFileHeader& header)
+{
+    return header.indices_offset + header.point_count * sizeof(uint32_t);
+}
+
+bool WriteGridFile(const char* path, const GridView& grid)
+{
+    const GridFileHeader header = MakeGridFileHeader(grid);
+
+    FILE* file = std::fopen(path, "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    // Sequential writes with zero padding, no seeks past 2GB.
+    uint64_t position = 0;
+    const char padding[64] = {};
+
+    const auto write_at = [&](uint64_t offset, const void* data, size_t size)
+    {
+        while (position < offset)
+        {
+            const size_t n = static_cast<size_t>(
+                std::min<uint64_t>(sizeof(padding), offset - position));
+            if (std::fwrite(padding, 1, n, file) != n)
+            {
+                return false;
+            }
+            position += n;
+        }
+
+        position += size;
+        return std::fwrite(data, 1, size, file) == size;
+    };
+
+    bool written =
+        write_at(0, &header, sizeof(header)) &&
+        write_at(
+            header.buckets_offset,
+            grid.buckets_start,
+            (grid.bucket_count + 1) * sizeof(uint32_t)) &&
+        write_at(
+            header.positions_offset,
+            grid.positions,
+            grid.Size() * sizeof(vec3)) &&
+        write_at(
+            header.indices_offset,
+            grid.indices,
+            grid.Size() * sizeof(uint32_t));
+
+    written &= std::fclose(file) == 0;
+    return written;
+}
+
+GridFile::GridFile(const char* path) :
+    file_(path, MappedAccess::Random)
+{
+    if (!file_.IsOpen() || file_.Size() < sizeof(GridFileHeader))
+    {
+        return;
+    }
+
+    GridFileHeader header;
+    std::memcpy(&header, file_.Data(), sizeof(header));
+
+    if (!ValidGridFileHeader(header, file_.Size()))
+    {
+        return;
+    }
+
+    cell_size = header.cell_size;
+    bounds = vec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+    bucket_count = header.bucket_count;
+    bucket_shift = fib_calc_bucket_shift(bucket_count);
+    point_count = static_cast<size_t>(header.point_count);
+
+    // The directory is small and read by every query, keep it resident.
+    buckets_start_.resize(bucket_count + 1);
+    std::memcpy(
+        buckets_start_.data(),
+        file_.Data() + header.buckets_offset,
+        buckets_start_.size() * sizeof(uint32_t));
+
+    if (!ValidGridBuckets(buckets_start_.data(), bucket_count, header.point_count))
+    {
+        return;
+    }
+
+    positions = reinterpret_cast<const vec3*>(
+        file_.Data() + header.positions_offset);
+    indices = reinterpret_cast<const uint32_t*>(
+        file_.Data() + header.indices_offset);
+    buckets_start = buckets_start_.data();
+}
+
+void GridFile::PrefetchBuckets(std::vector<uint32_t>& buckets) const
+{
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+
+    const uint8_t* base = file_.Data();
+
+    // Merge point runs closer than a page into one request.
+    size_t run_begin = 0;
+    size_t run_end = 0;
+
+    const auto flush = [&]
+    {
+        if (run_end > run_begin)
+        {
+            const size_t p0 = run_begin * sizeof(vec3);
+            const size_t p1 = run_end * sizeof(vec3);
+            const size_t i0 = run_begin * sizeof(uint32_t);
+            const size_t i1 = run_end * sizeof(uint32_t);
+
+            file_.Prefetch(
+                reinterpret_cast<const uint8_t*>(positions) - base + p0,
+                p1 - p0);
+            file_.Prefetch(
+                reinterpret_cast<const uint8_t*>(indices) - base + i0,
+                i1 - i0);
+        }
+    };
+
+    const size_t page_points = grid_file_alignment / sizeof(vec3);
+
+    for (const uint32_t b : buckets)
+    {
+        const size_t k0 = buckets_start[b];
+        const size_t k1 = buckets_start[b + 1];
+
+        if (k0 == k1)
+        {
+            continue;
+        }
+
+        if (run_end > run_begin && k0 <= run_end + page_points)
+        {
+            run_end = std::max(run_end, k1);
+        }
+        else
+        {
+            flush();
+            run_begin = k0;
+            run_end = k1;
+        }
+    }
+
+    flush();
+}
+
+void GridFile::Prefetch(const vec3* queries, const size_t count) const
+{
+    if (!IsOpen())
+    {
+        return;
+    }
+
+    std::vector<uint32_t> buckets;
+    buckets.reserve(count * 8);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t neighbours[8];
+        const uint32_t n = NeighbourBuckets(queries[i], neighbours);
+        buckets.insert(buckets.end(), neighbours, neighbours + n);
+    }
+
+    PrefetchBuckets(buckets);
+}
+
+void GridFile::Prefetch(const vec3 region_min, const vec3 region_max) const
+{
+    if (!IsOpen())
+    {
+        return;
+    }
+
+    // Queries in the box also read the neighbour cells across its faces,
+    // so it is padded by a cell. Cell coordinates are the unsigned ones
+    // hashing sees, clamped before leaving float.
+    const vec3 limit(static_cast<float>(std::numeric_limits<uint32_t>::max()));
+    const vec3 c0 = glm::clamp(
+        glm::floor((region_min + bounds) / cell_size) - 1.0f, vec3(0.0f), limit);
+    const vec3 c1 = glm::clamp(
+        glm::floor((region_max + bounds) / cell_size) + 1.0f, vec3(0.0f), limit);
+
+    const int64_t x0 = static_cast<int64_t>(c0.x);
+    const int64_t y0 = static_cast<int64_t>(c0.y);
+    const int64_t z0 = static_cast<int64_t>(c0.z);
+    const int64_t x1 = static_cast<int64_t>(c1.x);
+    const int64_t y1 = static_cast<int64_t>(c1.y);
+    const int64_t z1 = static_cast<int64_t>(c1.z);
+
+    if (x1 < x0 || y1 < y0 || z1 < z0)
+    {
+        return;
+    }
+
+    const double cells =
+        static_cast<double>(x1 - x0 + 1) *
+        static_cast<double>(y1 - y0 + 1) *
+        static_cast<double>(z1 - z0 + 1);
+
+    if (cells > static_cast<double>(bucket_count))
+    {
+        file_.Prefetch(0, file_.Size());
+        return;
+    }
+
+    std::vector<uint32_t> buckets;
+    buckets.reserve(static_cast<size_t>(cells));
+
+    for (int64_t z = z0; z <= z1; z++)
+    {
+        for (int64_t y = y0; y <= y1; y++)
+        {
+            for (int64_t x = x0; x <= x1; x++)
+            {
+                const uint32_t cell_hash = hash_cell(
+                    static_cast<uint32_t>(x),
+                    static_cast<uint32_t>(y),
+                    static_cast<uint32_t>(z));
+                buckets.push_back(fib_hash_to_index(cell_hash, bucket_shift));
+            }
+        }
+    }
+
+    PrefetchBuckets(buckets);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Grid.hpp"
+#include "MappedFile.hpp"
+
+/* Cell sorted grid file */
+
+// Layout, little endian, sections aligned to 'grid_file_alignment':
+//   GridFileHeader
+//   buckets_start, bucket_count + 1 uint32
+//   positions, point_count vec3 in bucket order
+//   indices, point_count uint32
+
+const uint32_t grid_file_version = 1;
+const uint64_t grid_file_alignment = 4096;
+
+struct GridFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    float cell_size;
+    float bounds[3];
+    uint32_t bucket_count;
+    uint32_t reserved;
+    uint64_t point_count;
+    uint64_t buckets_offset;
+    uint64_t positions_offset;
+    uint64_t indices_offset;
+};
+
+// Header of 'grid' with its section offsets, relative to the header.
+GridFileHeader MakeGridFileHeader(const GridView& grid);
+
+// Checks the magic, version and that every section fits in 'size' bytes.
+bool ValidGridFileHeader(const GridFileHeader& header, const uint64_t size);
+
+// Checks the bucket directory read from a file or segment: runs must not
+// go backwards or past the points.
+bool ValidGridBuckets(
+    const uint32_t* buckets_start,
+    const uint32_t bucket_count,
+    const uint64_t point_count);
+
+// Total size of the layout described by 'header'.
+uint64_t GridFileSize(const GridFileHeader& header);
+
+bool WriteGridFile(const char* path, const GridView& grid);
+
+// Grid file queried in place. Only the bucket directory is read up front,
+// point runs are faulted in a page at a time as queries touch them.
+class GridFile : public GridView
+{
+private:
+    MappedFile file_;
+    std::vector<uint32_t> buckets_start_;
+
+    void PrefetchBuckets(std::vector<uint32_t>& buckets) const;
+
+public:
+    GridFile(const char* path);
+
+    GridFile(const GridFile&) = delete;
+    GridFile& operator=(const GridFile&) = delete;
+
+    bool IsOpen() const
+    {
+        return buckets_start != nullptr;
+    }
+
+    // Starts paging in the points every query's neighbour buckets hold.
+    void Prefetch(const vec3* queries, const size_t count) const;
+
+    // Starts paging in the points of every cell overlapping the box or
+    // bordering it, or the whole file when that is more cells than there
+    // are buckets.
+    void Prefetch(const vec3 region_min, const vec3 region_max) const;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Common.hpp"
+
+/* Math setup */
+
+inline float fract2(const float x)
+{
+    return x >= 0. ? x - std::floor(x) : x - std::ceil(x);
+}
+
+/* General hash functions. */
+
+// Spatial hash from:
+// https://matthias-research.github.io/pages/publications/tetraederCollision.pdf
+// We do not use the local space hashing properties of this function. As the
+// fib hash just needs some high ranging hash to map to a low one. Removing,
+// the fib hash to utilize the spatial cache locality of this function would
+// require setting of 'hash_bounds' to the min/max points in the cloud. As it
+// is currently 'hash_bounds' is not too important.
+
+const vec3 hash_bounds = vec3(1024.0, 1024.0, 1024.0);
+const uint32_t hash_prime_1 = 73856093u;
+const uint32_t hash_prime_2 = 19349663u;
+const uint32_t hash_prime_3 = 83492791u;
+
+// Hash of integer cell coordinates, as the position hashes below compute
+// them.
+inline uint32_t hash_cell(const uint32_t x, const uint32_t y, const uint32_t z)
+{
+    return hash_prime_1 * x ^ hash_prime_2 * y ^ hash_prime_3 * z;
+}
+
+inline uint32_t hash(
+    const vec3 pos,
+    const float cell_size = BUCKET_SIZE,
+    const vec3 bounds = hash_bounds)
+{
+    const vec3 p = (pos + bounds) / cell_size;
+    const uint32_t x = static_cast<uint32_t>(p.x);
+    const uint32_t y = static_cast<uint32_t>(p.y);
+    const uint32_t z = static_cast<uint32_t>(p.z);
+    return hash_cell(x, y, z);
+}
+
+inline uint32_t hash(
+    const vec3 pos,
+    const vec3 offset,
+    const float cell_size = BUCKET_SIZE,
+    const vec3 bounds = hash_bounds)
+{
+    const vec3 p0 = (pos + bounds) / cell_size;
+
+    const vec3 p1 = p0 + vec3(
+        fract2(p0.x) < 0.5 ? -1 : 0,
+        fract2(p0.y) < 0.5 ? -1 : 0,
+        fract2(p0.z) < 0.5 ? -1 : 0);
+
+    const vec3 p2 = p1 + offset;
+    const uint32_t x = static_cast<uint32_t>(p2.x);
+    const uint32_t y = static_cast<uint32_t>(p2.y);
+    const uint32_t z = static_cast<uint32_t>(p2.z);
+    return hash_cell(x, y, z);
+}
+
+const vec3 hash_bucket_offsets[8] = {
+    vec3(0, 0, 0),
+    vec3(1, 0, 0),
+    vec3(0, 1, 0),
+    vec3(1, 1, 0),
+    vec3(0, 0, 1),
+    vec3(1, 0, 1),
+    vec3(0, 1, 1),
+    vec3(1, 1, 1)
+};
+
+/* Fibonacci Hashing */
+// https://probablydance.com/2018/06/16/
+
+inline uint32_t fib_calc_bucket_shift(const uint32_t bucket_count)
+{
+    return 32 - static_cast<uint32_t>(log2(bucket_count));
+}
+
+// Smallest power of two bucket count giving roughly 'points_per_bucket'
+// points per bucket, never below NUM_BUCKETS.
+inline uint32_t fib_calc_bucket_count(
+    const size_t point_count,
+    const size_t points_per_bucket = 8)
+{
+    uint32_t bucket_count = NUM_BUCKETS;
+    while (bucket_count < (1u << 30) &&
+           bucket_count * points_per_bucket < point_count)
+    {
+        bucket_count <<= 1;
+    }
+    return bucket_count;
+}
+
+const uint32_t fib_bucket_shift = fib_calc_bucket_shift(NUM_BUCKETS);
+
+inline uint32_t fib_hash_to_index(
+    const uint32_t hash,
+    const uint32_t bucket_shift = fib_bucket_shift)
+{
+    const uint32_t hash2 = hash ^ (hash >> bucket_shift);
+    return (2654435769u * hash2) >> bucket_shift;
+}
+
+inline uint32_t fib_hash(const vec3 pos)
+{
+    return fib_hash_to_index(hash(pos));
+};
+
+inline uint32_t fib_hash(const vec3 pos, const vec3 offset)
+{
+    return fib_hash_to_index(hash(pos, offset));
+};
+
+/* Morton codes */
+
+// Spreads the low 21 bits of 'x' three bits apart, for Morton codes.
+inline uint64_t morton_spread(uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
@@ -0,0 +1,157 @@
+#include "Join.hpp"
+
+JoinResult SpatialJoin(
+    const vec3* left,
+    const size_t left_count,
+    const vec3* right,
+    const size_t right_count,
+    const JoinOptions& options,
+    const JoinConsumer& consumer)
+{
+    JoinResult result;
+
+    if (left_count == 0 || right_count == 0 || options.max_pairs == 0)
+    {
+        return result;
+    }
+
+    const bool build_left = left_count <= right_count;
+    const vec3* build = build_left ? left : right;
+    const vec3* probe = build_left ? right : left;
+    const size_t build_count = build_left ? left_count : right_count;
+    const size_t probe_count = build_left ? right_count : left_count;
+
+    // Half-cell neighbour buckets are exact within half a cell.
+    const float cell_size = options.distance * 2.0f;
+
+    Grid build_grid(
+        cell_size,
+        fib_calc_bucket_count(build_count),
+        options.bounds);
+    build_grid.Build(build, build_count);
+
+    // Same cell size, so probe points sharing a bucket also share the
+    // neighbour buckets they visit in 'build_grid'.
+    Grid probe_grid(cell_size, build_grid.bucket_count, options.bounds);
+    probe_grid.Build(probe, probe_count);
+
+    const float distance2 = options.distance * options.distance;
+    const size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+
+    std::atomic<size_t> emitted(0);
+    std::atomic<bool> truncated(false);
+    std::atomic<bool> capped(false);
+    std::atomic<uint32_t> next_bucket(0);
+    std::mutex consumer_mutex;
+
+    const uint32_t buckets_per_task = 64;
+
+    ResolveConcurrent([&](uint32_t, uint32_t)
+    {
+        std::vector<JoinPair> chunk;
+        chunk.reserve(chunk_size);
+
+        // Reserve room in the global limit before handing pairs over, so
+        // the consumer never sees more than 'max_pairs'.
+        const auto flush = [&]
+        {
+            if (chunk.empty())
+            {
+                return;
+            }
+
+            size_t count = chunk.size();
+            size_t before = emitted.load();
+            do
+            {
+                count = std::min(chunk.size(), options.max_pairs - before);
+            }
+            while (!emitted.compare_exchange_weak(before, before + count));
+
+            if (count < chunk.size())
+            {
+                truncated = true;
+            }
+
+            if (count > 0)
+            {
+                std::lock_guard<std::mutex> lock(consumer_mutex);
+                consumer(chunk.data(), count);
+            }
+
+            chunk.clear();
+        };
+
+        while (!truncated)
+        {
+            const uint32_t first = next_bucket.fetch_add(buckets_per_task);
+            if (first >= probe_grid.bucket_count)
+            {
+                break;
+            }
+
+            const uint32_t last = std::min(
+                first + buckets_per_task,
+                probe_grid.bucket_count);
+
+            const uint32_t i0 = probe_grid.buckets_start[first];
+            const uint32_t i1 = probe_grid.buckets_start[last];
+
+            for (uint32_t i = i0; i < i1 && !truncated; i++)
+            {
+                const vec3 p0 = probe_grid.positions[i];
+                const uint32_t probe_index = probe_grid.indices[i];
+
+                uint32_t buckets[8];
+                const uint32_t bucket_count =
+                    build_grid.NeighbourBuckets(p0, buckets);
+
+                uint32_t point_pairs = 0;
+
+                for (uint32_t j = 0; j < bucket_count; j++)
+                {
+                    const uint32_t k0 = build_grid.buckets_start[buckets[j]];
+                    const uint32_t k1 = build_grid.buckets_start[buckets[j] + 1];
+
+                    for (uint32_t k = k0;
+                         k < k1 && point_pairs < options.max_pairs_per_point;
+                         k++)
+                    {
+                        const vec3 d = build_grid.positions[k] - p0;
+                        const float d2 = glm::dot(d, d);
+
+                        if (d2 <= distance2)
+                        {
+                            const uint32_t build_index = build_grid.indices[k];
+
+                            chunk.push_back({
+                                build_left ? build_index : probe_index,
+                                build_left ? probe_index : build_index,
+                                std::sqrt(d2)
+                            });
+
+                            point_pairs++;
+
+                            if (chunk.size() == chunk_size)
+                            {
+                                flush();
+                            }
+                        }
+                    }
+                }
+
+                if (point_pairs == options.max_pairs_per_point)
+                {
+                    capped = true;
+                }
+            }
+        }
+
+        flush();
+    });
+
+    result.pairs = emitted;
+    result.truncated = truncated;
+    result.capped = capped;
+    return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Grid.hpp"
+
+#include <functional>
+
+/* Spatial join */
+
+struct JoinPair
+{
+    uint32_t left;
+    uint32_t right;
+    float distance;
+};
+
+struct JoinOptions
+{
+    float distance = BUCKET_SIZE * 0.5f;
+    // Hash bounds of both grids, see Grid::bounds.
+    vec3 bounds = hash_bounds;
+    // Stop once this many pairs have been emitted in total.
+    size_t max_pairs = std::numeric_limits<size_t>::max();
+    // Cap on pairs emitted for each point of the larger set.
+    uint32_t max_pairs_per_point = std::numeric_limits<uint32_t>::max();
+    // Pairs buffered per worker before being handed to the consumer.
+    size_t chunk_size = 4096;
+};
+
+struct JoinResult
+{
+    size_t pairs = 0;
+    // 'max_pairs' was reached and the join stopped early.
+    bool truncated = false;
+    // Some point reached 'max_pairs_per_point'.
+    bool capped = false;
+};
+
+// Receives chunks of pairs, calls are serialized but come from any worker.
+using JoinConsumer = std::function<void(const JoinPair* pairs, size_t count)>;
+
+// Streams every (left, right) pair within 'options.distance' to 'consumer'.
+// A grid is built over the smaller set and the larger set is partitioned by
+// cell so each worker probes one cell's points against the same buckets.
+// Indices in the pairs are input indices of 'left' and 'right'.
+JoinResult SpatialJoin(
+    const vec3* left,
+    const size_t left_count,
+    const vec3* right,
+    const size_t right_count,
+    const JoinOptions& options,
+    const JoinConsumer& consumer);
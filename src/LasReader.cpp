@@ -0,0 +1,162 @@
+#include "LasReader.hpp"
+
+#include "MappedFile.hpp"
+
+#include <cstring>
+
+template <typename T>
+static inline T read_le(const uint8_t* p)
+{
+    // LAS is little endian, as are the platforms we build for.
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+static bool ReadHeader(const MappedFile& file, LasHeader& header, uint32_t& data_offset)
+{
+    const uint8_t* p = file.Data();
+
+    if (file.Size() < 227 || std::memcmp(p, "LASF", 4) != 0)
+    {
+        return false;
+    }
+
+    header.version_major = p[24];
+    header.version_minor = p[25];
+    data_offset = read_le<uint32_t>(p + 96);
+    header.point_format = p[104];
+    header.record_length = read_le<uint16_t>(p + 105);
+    header.point_count = read_le<uint32_t>(p + 107);
+
+    header.scale = glm::dvec3(
+        read_le<double>(p + 131),
+        read_le<double>(p + 139),
+        read_le<double>(p + 147));
+    header.offset = glm::dvec3(
+        read_le<double>(p + 155),
+        read_le<double>(p + 163),
+        read_le<double>(p + 171));
+    header.max = glm::dvec3(
+        read_le<double>(p + 179),
+        read_le<double>(p + 195),
+        read_le<double>(p + 211));
+    header.min = glm::dvec3(
+        read_le<double>(p + 187),
+        read_le<double>(p + 203),
+        read_le<double>(p + 219));
+
+    // Records follow the header and any variable length records.
+    const uint16_t header_size = read_le<uint16_t>(p + 94);
+    if (header_size < 227 ||
+        header_size > file.Size() ||
+        data_offset < header_size ||
+        data_offset > file.Size())
+    {
+        return false;
+    }
+
+    // 1.4 keeps a 64 bit count, the legacy one is zero for formats 6+.
+    if (header.version_minor >= 4 && header_size >= 255)
+    {
+        const uint64_t count = read_le<uint64_t>(p + 247);
+        header.point_count = count > 0 ? count : header.point_count;
+    }
+
+    // LAZ sets the high bits of the format, so compressed files fail here.
+    const uint8_t minimum_length[11] = {
+        20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67
+    };
+
+    if (header.point_format > 10 ||
+        header.record_length < minimum_length[header.point_format])
+    {
+        return false;
+    }
+
+    // More records than the file holds means it was cut short.
+    return header.point_count <= (file.Size() - data_offset) / header.record_length;
+}
+
+bool LoadLas(
+    const char* path,
+    Grid& grid,
+    const LasOptions& options,
+    LasHeader* header_out)
+{
+    MappedFile file(path);
+
+    if (!file.IsOpen())
+    {
+        return false;
+    }
+
+    LasHeader header;
+    uint32_t data_offset = 0;
+
+    if (!ReadHeader(file, header, data_offset))
+    {
+        return false;
+    }
+
+    if (header_out)
+    {
+        *header_out = header;
+    }
+
+    const uint8_t* records = file.Data() + data_offset;
+    const bool extended = header.point_format >= 6;
+
+    // Scale and offset folded into one multiply add relative to 'min'.
+    const glm::dvec3 origin = header.offset - header.min;
+
+    // One contiguous chunk per worker keeps file order across slices, and
+    // the slice histograms at one per worker.
+    std::vector<GridSlice> slices(concurrent_threads());
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        const uint64_t r0 = header.point_count * start / step;
+        const uint64_t r1 = header.point_count * (start + 1) / step;
+
+        GridSlice& slice = slices[start];
+        slice.positions.reserve(static_cast<size_t>(r1 - r0));
+        slice.bucket_ids.reserve(static_cast<size_t>(r1 - r0));
+        slice.histogram.assign(grid.bucket_count, 0);
+
+        for (uint64_t r = r0; r < r1; r++)
+        {
+            const uint8_t* record = records + r * header.record_length;
+
+            // Formats 6+ widen return fields to 4 bits and move the
+            // full classification byte from 15 to 16.
+            const uint8_t returns = record[14];
+            const uint32_t return_number = extended ?
+                returns & 0x0f : returns & 0x07;
+            const uint32_t return_count = extended ?
+                returns >> 4 : (returns >> 3) & 0x07;
+            const uint8_t classification = extended ?
+                record[16] : record[15] & 0x1f;
+
+            if (!options.classifications[classification] ||
+                !(options.return_numbers >> return_number & 1) ||
+                (options.last_returns_only && return_number != return_count))
+            {
+                continue;
+            }
+
+            const vec3 position = vec3(
+                read_le<int32_t>(record) * header.scale.x + origin.x,
+                read_le<int32_t>(record + 4) * header.scale.y + origin.y,
+                read_le<int32_t>(record + 8) * header.scale.z + origin.z);
+
+            const uint32_t bucket_id = grid.Bucket(position);
+            slice.positions.push_back(position);
+            slice.bucket_ids.push_back(bucket_id);
+            slice.histogram[bucket_id]++;
+        }
+    });
+
+    grid.Build(slices);
+    return true;
+}
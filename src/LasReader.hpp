@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Grid.hpp"
+
+#include <bitset>
+
+/* LAS reader */
+
+struct LasHeader
+{
+    uint8_t version_major = 0;
+    uint8_t version_minor = 0;
+    uint8_t point_format = 0;
+    uint16_t record_length = 0;
+    uint64_t point_count = 0;
+    glm::dvec3 scale;
+    glm::dvec3 offset;
+    glm::dvec3 min;
+    glm::dvec3 max;
+};
+
+struct LasOptions
+{
+    // Classes to keep, all by default.
+    std::bitset<256> classifications = std::bitset<256>().set();
+    // Bit n keeps return number n, all by default.
+    uint32_t return_numbers = 0xffffffffu;
+    // Keep only the last return of each pulse.
+    bool last_returns_only = false;
+};
+
+// Reads an uncompressed LAS 1.2 - 1.4 file, point formats 0 - 10, into
+// 'grid'. Each worker decodes a contiguous run of records, filtering during
+// decode, and positions are relative to the header minimum so they keep float
+// precision with georeferenced offsets, add 'header.min' to restore them.
+// Grid indices count kept points in file order. Returns false when the file
+// is not a readable LAS file, including one with fewer records than its
+// header counts.
+bool LoadLas(
+    const char* path,
+    Grid& grid,
+    const LasOptions& options = LasOptions(),
+    LasHeader* header = nullptr);
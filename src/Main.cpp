@@ -2,39 +2,33 @@
 
 #include "Worker.hpp"
 
+#include "Grid.hpp"
+#include "Random.hpp"
+#include "TaskGraph.hpp"
+
 #include <array>
-#include <random>
 #include <chrono>
 #include <iostream>
+#include <string>
 
-#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
-#define GLM_ENABLE_EXPERIMENTAL
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-
-#include <glm/glm.hpp>
-#include <glm/vec3.hpp>
-
-using glm::vec3;
 using hrc = std::chrono::high_resolution_clock;
 
 /* Parameters */
 
-#define CONCURRENT
 #define NUM_POINTS 1000000
-#define NUM_BUCKETS 16384
-#define BUCKET_SIZE 0.5f
-
-/* Math setup */
-
-std::default_random_engine rand_generator;
-std::uniform_real_distribution<float> rand_distribution(0.0f, 1000.0f);
-inline float next_rand() { return rand_distribution(rand_generator); }
-
-inline float fract2(const float x)
-{
-    return x >= 0. ? x - std::floor(x) : x - std::ceil(x);
-}
+#define SEARCH_EPSILON 0.0f
+#define SEARCH_MAX_CANDIDATES 0xffffffffu
+#define RECALL_SAMPLES 10000
+#define RANDOM_SEED 0
+#define POINT_CLOUD_EXTENT 1000.0f
+// Query batched exact kernel, pays off on dense clouds. Ignores the
+// epsilon and candidate budget.
+// #define BATCHED_SEARCH
+// Generate, hash, sort, search and reduce as one graph of chunk tasks
+// instead of stages separated by barriers. Reports one pipeline time that
+// includes generation, uses the per point search.
+// #define TASK_GRAPH_PIPELINE
+#define PIPELINE_CHUNKS_PER_THREAD 4
 
 /* Timing  */
 
@@ -51,84 +45,6 @@ inline auto timer_end(hrc::time_point& timer_start_point)
     return time_span.count() * 1000;
 }
 
-/* General hash functions. */
-
-// Spatial hash from:
-// https://matthias-research.github.io/pages/publications/tetraederCollision.pdf
-// We do not use the local space hashing properties of this function. As the
-// fib hash just needs some high ranging hash to map to a low one. Removing,
-// the fib hash to utilize the spatial cache locality of this function would
-// require setting of 'hash_bounds' to the min/max points in the cloud. As it
-// is currently 'hash_bounds' is not too important.
-
-const vec3 hash_bounds = vec3(1024.0, 1024.0, 1024.0);
-const uint32_t hash_prime_1 = 73856093u;
-const uint32_t hash_prime_2 = 19349663u;
-const uint32_t hash_prime_3 = 83492791u;
-
-inline uint32_t hash(const vec3 pos)
-{
-    const vec3 p = (pos + hash_bounds) / BUCKET_SIZE;
-    const uint32_t x = static_cast<uint32_t>(p.x);
-    const uint32_t y = static_cast<uint32_t>(p.y);
-    const uint32_t z = static_cast<uint32_t>(p.z);
-    return hash_prime_1 * x ^ hash_prime_2 * y ^ hash_prime_3 * z;
-}
-
-inline uint32_t hash(const vec3 pos, const vec3 offset)
-{
-    const vec3 q = vec3(1024.0, 1024.0, 1024.0);
-    const vec3 p0 = (pos + hash_bounds) / BUCKET_SIZE;
-
-    const vec3 p1 = p0 + vec3(
-        fract2(p0.x) < 0.5 ? -1 : 0,
-        fract2(p0.y) < 0.5 ? -1 : 0,
-        fract2(p0.z) < 0.5 ? -1 : 0);
-
-    const vec3 p2 = p1 + offset;
-    const uint32_t x = static_cast<uint32_t>(p2.x);
-    const uint32_t y = static_cast<uint32_t>(p2.y);
-    const uint32_t z = static_cast<uint32_t>(p2.z);
-    return hash_prime_1 * x ^ hash_prime_2 * y ^ hash_prime_3 * z;
-}
-
-const vec3 hash_bucket_offsets[8] = {
-    vec3(0, 0, 0),
-    vec3(1, 0, 0),
-    vec3(0, 1, 0),
-    vec3(1, 1, 0),
-    vec3(0, 0, 1),
-    vec3(1, 0, 1),
-    vec3(0, 1, 1),
-    vec3(1, 1, 1)
-};
-
-/* Fibonacci Hashing */
-// https://probablydance.com/2018/06/16/
-
-inline uint32_t fib_calc_bucket_shift(const uint32_t bucket_count)
-{
-    return 32 - static_cast<uint32_t>(log2(bucket_count));
-}
-
-const uint32_t fib_bucket_shift = fib_calc_bucket_shift(NUM_BUCKETS);
-
-inline uint32_t fib_hash_to_index(const uint32_t hash)
-{
-    const uint32_t hash2 = hash ^ (hash >> fib_bucket_shift);
-    return (2654435769u * hash2) >> fib_bucket_shift;
-}
-
-inline uint32_t fib_hash(const vec3 pos)
-{
-    return fib_hash_to_index(hash(pos));
-};
-
-inline uint32_t fib_hash(const vec3 pos, const vec3 offset)
-{
-    return fib_hash_to_index(hash(pos, offset));
-};
-
 /* Point cloud */
 
 struct Point
@@ -139,32 +55,54 @@ struct Point
     uint32_t nearest_index = 0;
 };
 
-std::array<Point, NUM_POINTS> point_cloud_input;
-std::array<Point, NUM_POINTS> point_cloud_sorted;
+std::array<vec3, NUM_POINTS> point_cloud_input;
+// In input order, 'nearest_index' is an input index too.
 std::array<Point, NUM_POINTS> point_cloud_final;
 
 /* Sorting buckets */
 
-std::array<uint32_t, NUM_POINTS>  buckets_id;
-std::array<uint32_t, NUM_BUCKETS> buckets_hash;
-std::array<uint32_t, NUM_BUCKETS> buckets_boundary;
+Grid grid;
+SearchOptions search_options;
+
+#ifdef BATCHED_SEARCH
+std::array<Nearest, NUM_POINTS> nearest_results;
+#endif
 
 void NNApproxSearch(uint32_t start, uint32_t step);
 
-int main(int argc, char* argv[])
+struct ClosestPair
 {
-    // Create a random point cloud
-    for (auto& point : point_cloud_input)
-    {
-        const vec3 position = vec3(next_rand(), next_rand(), next_rand());
-        const uint32_t bucket_id = fib_hash(position);
+    float distance = std::numeric_limits<float>::max();
+    uint32_t index_0 = 0;
+    uint32_t index_1 = 0;
+};
 
-        point =
-        {
-            position,
-            bucket_id
-        };
-    }
+Nearest NNSearchPoint(const uint32_t i);
+ClosestPair FindClosestPair(const uint32_t k0, const uint32_t k1);
+float NNPipeline(ClosestPair& closest);
+
+int main(int argc, char* argv[])
+{
+    // Optional operating point: nnsearch [epsilon] [max_candidates]
+    search_options.epsilon = argc > 1 ?
+        std::stof(argv[1]) : SEARCH_EPSILON;
+    search_options.max_candidates = argc > 2 ?
+        static_cast<uint32_t>(std::stoul(argv[2])) : SEARCH_MAX_CANDIDATES;
+
+    // Measure worker wake cost now rather than inside a timed phase.
+    concurrent_worker_cost();
+
+#ifdef TASK_GRAPH_PIPELINE
+    ClosestPair closest;
+    const float pipeline_time = NNPipeline(closest);
+#else
+    // Create a random point cloud, the same for any thread count.
+    GenerateUniformPoints(
+        point_cloud_input.data(),
+        point_cloud_input.size(),
+        RANDOM_SEED,
+        vec3(0.0f),
+        vec3(POINT_CLOUD_EXTENT));
 
     // Create thread workers if using concurrency
 #ifdef CONCURRENT
@@ -184,39 +122,7 @@ int main(int argc, char* argv[])
     hrc::time_point sort_timer_start_point = timer_start();
 
     // Sort points by buckets using O(n) sort.
-    std::fill(buckets_hash.begin(), buckets_hash.end(), 0);
-
-    // This part can be done in parallel using atomics, and would be on the GPU.
-    // But on the CPU gains are not enormous for reasonable sizes of clouds.
-    for (auto& p : point_cloud_input)
-    {
-        buckets_hash[p.bucket_id]++;
-    }
-
-    for (uint32_t i = 1; i < NUM_BUCKETS; i++)
-    {
-        buckets_hash[i] += buckets_hash[i - 1];
-    }
-
-    for (auto& p : point_cloud_input)
-    {
-        buckets_hash[p.bucket_id] -= 1;
-        point_cloud_sorted[buckets_hash[p.bucket_id]] = p;
-    }
-
-    // Calculate boundaries between buckets_ids of sorted points.
-    uint32_t current = NUM_BUCKETS + 1;
-    std::fill(buckets_boundary.begin(), buckets_boundary.end(), -1);
-
-    for (uint32_t i = 0; i < NUM_POINTS; i++)
-    {
-        Point& p = point_cloud_sorted[i];
-        if (p.bucket_id > current || current == NUM_BUCKETS + 1)
-        {
-            buckets_boundary[p.bucket_id] = i;
-            current = p.bucket_id;
-        }
-    }
+    grid.Build(point_cloud_input.data(), point_cloud_input.size());
 
     auto sort_time = timer_end(sort_timer_start_point);
 
@@ -235,100 +141,244 @@ int main(int argc, char* argv[])
     auto search_time = timer_end(search_timer_start_point);
 
     // O(n) search for the closest that we found
-    float nearest_found_dist = std::numeric_limits<float>::max();
-    uint32_t nearest_found_index_0 = 0;
-    uint32_t nearest_found_index_1 = 0;
+    const ClosestPair closest = FindClosestPair(0, NUM_POINTS);
+#endif
 
-    for (uint32_t i = 0; i < NUM_POINTS; i++)
+    // Recall against the exact search on a sample of points.
+    uint32_t recall_matches = 0;
+    double recall_ratio = 0.0;
+    uint32_t recall_ratio_count = 0;
+
+    for (uint32_t s = 0; s < RECALL_SAMPLES; s++)
     {
-        Point& p0 = point_cloud_final[i];
+        const uint32_t k = static_cast<uint32_t>(
+            static_cast<uint64_t>(s) * NUM_POINTS / RECALL_SAMPLES);
+
+        const Point& p0 = point_cloud_final[grid.indices[k]];
+        const Nearest exact = grid.FindNearest(p0.position, k);
+
+        if (!exact.found)
+        {
+            recall_matches += p0.found_nearest ? 0 : 1;
+            continue;
+        }
+
         if (p0.found_nearest)
         {
-            Point& p1 = point_cloud_final[p0.nearest_index];
+            const float dist = glm::length(
+                point_cloud_final[p0.nearest_index].position - p0.position);
 
-            float dist = glm::length(p1.position - p0.position);
-            if (dist < nearest_found_dist)
+            recall_matches += dist <= exact.distance ? 1 : 0;
+
+            if (exact.distance > 0.0f)
             {
-                nearest_found_dist = dist;
-                nearest_found_index_0 = i;
-                nearest_found_index_1 = p0.nearest_index;
+                recall_ratio += dist / exact.distance;
+                recall_ratio_count++;
             }
         }
     }
 
     std::cout << "Nearest found points: ";
-    std::cout << "#" << nearest_found_index_0;
+    std::cout << "#" << closest.index_0;
     std::cout << ", ";
-    std::cout << "#" << nearest_found_index_1;
+    std::cout << "#" << closest.index_1;
     std::cout << " distance:";
-    std::cout << nearest_found_dist;
+    std::cout << closest.distance;
     std::cout << " of " << NUM_POINTS << std::endl;
 
+    std::cout << "Recall: ";
+    std::cout << static_cast<float>(recall_matches) / RECALL_SAMPLES;
+    std::cout << " distance ratio: ";
+    std::cout << (recall_ratio_count > 0 ? recall_ratio / recall_ratio_count : 1.0);
+    std::cout << " (epsilon " << search_options.epsilon;
+    std::cout << ", max candidates " << search_options.max_candidates << ")";
+    std::cout << std::endl;
+
+#ifdef TASK_GRAPH_PIPELINE
+    std::cout << "Pipeline time: " << pipeline_time << "ms.";
+    std::cout << std::endl;
+#else
     std::cout << "Sort time: " << sort_time << "ms.";
     std::cout << std::endl;
     std::cout << "Search time: " << search_time << "ms.";
     std::cout << std::endl;
     std::cout << "Total time: " << total_time << "ms.";
     std::cout << std::endl;
+#endif
+}
+
+Nearest NNSearchPoint(const uint32_t i)
+{
+    const vec3 p0 = grid.positions[i];
+
+    // Search 8 neighbor buckets
+    const Nearest nearest = grid.FindNearest(p0, i, search_options);
+
+    // Written straight to the input order slot with the neighbour's
+    // input index, no inverse permutation pass afterwards.
+    point_cloud_final[grid.indices[i]] =
+    {
+        p0,
+        grid.bucket_ids[i],
+        nearest.found,
+        grid.indices[nearest.index]
+    };
+
+    return nearest;
+}
+
+// Closest pair among results of input points [k0, k1).
+ClosestPair FindClosestPair(const uint32_t k0, const uint32_t k1)
+{
+    ClosestPair closest;
+
+    for (uint32_t i = k0; i < k1; i++)
+    {
+        const Point& p0 = point_cloud_final[i];
+        if (p0.found_nearest)
+        {
+            const Point& p1 = point_cloud_final[p0.nearest_index];
+
+            const float dist = glm::length(p1.position - p0.position);
+            if (dist < closest.distance)
+            {
+                closest.distance = dist;
+                closest.index_0 = i;
+                closest.index_1 = p0.nearest_index;
+            }
+        }
+    }
+
+    return closest;
 }
 
 void NNApproxSearch(uint32_t start = 0, uint32_t step = 1)
 {
+#ifdef BATCHED_SEARCH
+    // Whole buckets per worker, so queries sharing a cell are batched.
+    for (uint32_t b = start; b < grid.bucket_count; b += step)
+    {
+        BatchedNearest(grid, b, nearest_results.data());
+
+        for (uint32_t i = grid.buckets_start[b]; i < grid.buckets_start[b + 1]; i++)
+        {
+            point_cloud_final[grid.indices[i]] =
+            {
+                grid.positions[i],
+                grid.bucket_ids[i],
+                nearest_results[i].found,
+                grid.indices[nearest_results[i].index]
+            };
+        }
+    }
+#else
     // For each point
     for (uint32_t i = start; i < NUM_POINTS; i += step)
     {
-        const Point& b0 = point_cloud_sorted[i];
+        NNSearchPoint(i);
+    }
+#endif
+}
 
-        // Search 8 neighbor buckets
-        float nearest_distance = std::numeric_limits<float>::max();
-        bool nearest_found = false;
-        uint32_t nearest_index = 0;
+// Every stage as chunk tasks. Each chunk is generated then hashed, the grid
+// is sized once all histograms are in and each chunk scattered, then sorted
+// ranges are searched, each reducing its own closest pair.
+float NNPipeline(ClosestPair& closest)
+{
+    const uint32_t chunks = concurrent_threads() * PIPELINE_CHUNKS_PER_THREAD;
 
-        for (uint32_t j = 0; j < 8; j++)
-        {
-            const uint32_t bucket_index = fib_hash(
-                b0.position,
-                hash_bucket_offsets[j]);
+    const auto chunk_begin = [=](uint32_t c)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(NUM_POINTS) * c / chunks);
+    };
+
+    std::vector<GridSlice> slices(chunks);
+    std::vector<std::vector<uint32_t>> slice_offsets;
+    std::vector<ClosestPair> chunk_closest(chunks);
 
-            int32_t k = buckets_boundary[bucket_index];
+    TaskGraph graph;
+    std::vector<TaskGraph::TaskId> hashed(chunks);
+    std::vector<TaskGraph::TaskId> scattered(chunks);
+    std::vector<TaskGraph::TaskId> searched(chunks);
+
+    for (uint32_t c = 0; c < chunks; c++)
+    {
+        const TaskGraph::TaskId generated = graph.Add([&, c]
+        {
+            GridSlice& slice = slices[c];
+            slice.positions.resize(chunk_begin(c + 1) - chunk_begin(c));
+            GenerateUniformRange(
+                slice.positions.data(),
+                chunk_begin(c),
+                chunk_begin(c + 1),
+                RANDOM_SEED,
+                vec3(0.0f),
+                vec3(POINT_CLOUD_EXTENT));
+        });
+
+        hashed[c] = graph.Add([&, c]
+        {
+            GridSlice& slice = slices[c];
+            slice.bucket_ids.resize(slice.positions.size());
+            slice.histogram.assign(grid.bucket_count, 0);
 
-            // No boundary found. Nothing in this bucket
-            if (k == -1)
+            for (size_t i = 0; i < slice.positions.size(); i++)
             {
-                continue;
+                slice.bucket_ids[i] = grid.Bucket(slice.positions[i]);
+                slice.histogram[slice.bucket_ids[i]]++;
             }
+        },
+        { generated });
+    }
 
-            // Loop until a point is found with
-            // a different id to the current bucket.
-            int32_t current_bucket_id = 0;
+    const TaskGraph::TaskId allocated = graph.Add([&]
+    {
+        slice_offsets = grid.Allocate(slices);
+    },
+    hashed);
 
-            do
-            {
-                const Point& b1 = point_cloud_sorted[k];
-                current_bucket_id = b1.bucket_id;
+    for (uint32_t c = 0; c < chunks; c++)
+    {
+        scattered[c] = graph.Add([&, c]
+        {
+            grid.ScatterSlice(slices, c, slice_offsets[c]);
+        },
+        { allocated });
+    }
 
-                if (i != k && current_bucket_id == bucket_index)
+    for (uint32_t c = 0; c < chunks; c++)
+    {
+        searched[c] = graph.Add([&, c]
+        {
+            ClosestPair& chunk = chunk_closest[c];
+
+            for (uint32_t i = chunk_begin(c); i < chunk_begin(c + 1); i++)
+            {
+                const Nearest nearest = NNSearchPoint(i);
+                if (nearest.found && nearest.distance < chunk.distance)
                 {
-                    const float d = glm::length(b1.position - b0.position);
-                    if (d < nearest_distance)
-                    {
-                        nearest_distance = d;
-                        nearest_index = k;
-                        nearest_found = true;
-                    }
+                    chunk.distance = nearest.distance;
+                    chunk.index_0 = grid.indices[i];
+                    chunk.index_1 = grid.indices[nearest.index];
                 }
+            }
+        },
+        scattered);
+    }
 
-                k++;
+    graph.Add([&]
+    {
+        for (const ClosestPair& chunk : chunk_closest)
+        {
+            if (chunk.distance < closest.distance)
+            {
+                closest = chunk;
             }
-            while (current_bucket_id == bucket_index && k < NUM_POINTS);
         }
+    },
+    searched);
 
-        point_cloud_final[i] =
-        {
-            b0.position,
-            b0.bucket_id,
-            nearest_found,
-            nearest_index
-        };
-    }
+    hrc::time_point pipeline_timer_start_point = timer_start();
+    graph.Run();
+    return timer_end(pipeline_timer_start_point);
 }
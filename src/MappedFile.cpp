@@ -0,0 +1,170 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char* path, const MappedAccess access)
+{
+    file_ = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        access == MappedAccess::Sequential ?
+            FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS,
+        nullptr);
+
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return;
+    }
+
+    mapping_ = CreateFileMappingA(
+        file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping_ == nullptr)
+    {
+        Close();
+        return;
+    }
+
+    data_ = static_cast<const uint8_t*>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    size_ = data_ ? static_cast<size_t>(size.QuadPart) : 0;
+}
+
+void MappedFile::Prefetch(const size_t offset, const size_t size) const
+{
+    if (!data_ || offset >= size_)
+    {
+        return;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(data_ + offset);
+    range.NumberOfBytes = std::min(size, size_ - offset);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::Close()
+{
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_)
+    {
+        CloseHandle(file_);
+    }
+
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const char* path, const MappedAccess access)
+{
+    file_ = open(path, O_RDONLY);
+
+    if (file_ < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(file_, &info) != 0 || info.st_size == 0)
+    {
+        Close();
+        return;
+    }
+
+    void* data = mmap(
+        nullptr,
+        static_cast<size_t>(info.st_size),
+        PROT_READ,
+        MAP_PRIVATE,
+        file_,
+        0);
+
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return;
+    }
+
+    data_ = static_cast<const uint8_t*>(data);
+    size_ = static_cast<size_t>(info.st_size);
+
+    madvise(
+        data,
+        size_,
+        access == MappedAccess::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
+
+void MappedFile::Prefetch(const size_t offset, const size_t size) const
+{
+    if (!data_ || offset >= size_)
+    {
+        return;
+    }
+
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / page * page;
+    const size_t end = std::min(size_, offset + size);
+
+    madvise(
+        const_cast<uint8_t*>(data_ + begin),
+        end - begin,
+        MADV_WILLNEED);
+}
+
+void MappedFile::Close()
+{
+    if (data_)
+    {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    if (file_ >= 0)
+    {
+        close(file_);
+    }
+
+    data_ = nullptr;
+    file_ = -1;
+    size_ = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Memory mapped file */
+
+enum class MappedAccess
+{
+    // Read ahead aggressively, for files parsed front to back.
+    Sequential,
+    // Fault in only the touched pages, for indexes queried in place.
+    Random
+};
+
+// Read only mapping of a whole file, empty when the file could not be
+// opened or mapped.
+class MappedFile
+{
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int file_ = -1;
+#endif
+
+    void Close();
+
+public:
+    MappedFile(
+        const char* path,
+        const MappedAccess access = MappedAccess::Sequential);
+    virtual ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const
+    {
+        return data_ != nullptr;
+    }
+
+    const uint8_t* Data() const
+    {
+        return data_;
+    }
+
+    size_t Size() const
+    {
+        return size_;
+    }
+
+    // Asks the OS to start reading [offset, offset + size) in the
+    // background, widened to whole pages.
+    void Prefetch(const size_t offset, const size_t size) const;
+};
@@ -0,0 +1,133 @@
+#include "Match.hpp"
+
+struct MatchCandidate
+{
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    float distance = 0.0f;
+    bool distinct = false;
+};
+
+// Nearest point of 'grid' within 'radius' of 'pos' and whether it passes
+// the ratio test against the second nearest.
+static MatchCandidate find_candidate(
+    const GridView& grid,
+    const vec3 pos,
+    const float radius,
+    const float ratio)
+{
+    uint32_t buckets[8];
+    float bounds2[8];
+    const uint32_t bucket_count =
+        grid.OrderedNeighbourBuckets(pos, buckets, bounds2);
+
+    float first2 = radius * radius;
+    float second2 = std::numeric_limits<float>::max();
+    uint32_t first = std::numeric_limits<uint32_t>::max();
+
+    for (uint32_t j = 0; j < bucket_count; j++)
+    {
+        // Both nearest found, or nothing nearer than the radius is left.
+        if (bounds2[j] > std::min(second2, radius * radius))
+        {
+            break;
+        }
+
+        const uint32_t k1 = grid.buckets_start[buckets[j] + 1];
+
+        for (uint32_t k = grid.buckets_start[buckets[j]]; k < k1; k++)
+        {
+            const vec3 d = grid.positions[k] - pos;
+            const float d2 = glm::dot(d, d);
+
+            if (d2 <= first2)
+            {
+                second2 = first == std::numeric_limits<uint32_t>::max() ?
+                    second2 : first2;
+                first2 = d2;
+                first = k;
+            }
+            else if (d2 < second2)
+            {
+                second2 = d2;
+            }
+        }
+    }
+
+    MatchCandidate candidate;
+
+    if (first != std::numeric_limits<uint32_t>::max())
+    {
+        // Without a second inside the radius it lies past it.
+        const float second = std::sqrt(std::min(second2, radius * radius));
+
+        candidate.index = grid.indices[first];
+        candidate.distance = std::sqrt(first2);
+        candidate.distinct = candidate.distance <= ratio * second;
+    }
+
+    return candidate;
+}
+
+std::vector<MatchPair> MutualNearest(
+    const vec3* left,
+    const size_t left_count,
+    const vec3* right,
+    const size_t right_count,
+    const MatchOptions& options)
+{
+    std::vector<MatchPair> pairs;
+
+    if (left_count == 0 || right_count == 0)
+    {
+        return pairs;
+    }
+
+    // Half-cell neighbour buckets are exact within half a cell.
+    const float cell_size = options.distance * 2.0f;
+
+    Grid left_grid(cell_size, fib_calc_bucket_count(left_count), options.bounds);
+    Grid right_grid(cell_size, fib_calc_bucket_count(right_count), options.bounds);
+    left_grid.Build(left, left_count);
+    right_grid.Build(right, right_count);
+
+    // In input order of the searching side.
+    std::vector<MatchCandidate> left_matches(left_count);
+    std::vector<MatchCandidate> right_matches(right_count);
+
+    // Both directions share the workers, each side walked in sorted order so
+    // consecutive queries visit the same buckets.
+    const size_t total = left_count + right_count;
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t n = start; n < total; n += step)
+        {
+            const bool from_left = n < left_count;
+            const Grid& from = from_left ? left_grid : right_grid;
+            const Grid& to = from_left ? right_grid : left_grid;
+            const size_t k = from_left ? n : n - left_count;
+
+            std::vector<MatchCandidate>& matches =
+                from_left ? left_matches : right_matches;
+
+            matches[from.indices[k]] = find_candidate(
+                to,
+                from.positions[k],
+                options.distance,
+                options.ratio);
+        }
+    });
+
+    for (uint32_t i = 0; i < left_count; i++)
+    {
+        const MatchCandidate& forward = left_matches[i];
+
+        if (forward.distinct && right_matches[forward.index].index == i &&
+            right_matches[forward.index].distinct)
+        {
+            pairs.push_back({ i, forward.index, forward.distance });
+        }
+    }
+
+    return pairs;
+}
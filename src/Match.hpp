@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Grid.hpp"
+
+#include <vector>
+
+/* Mutual nearest neighbour matching */
+
+struct MatchPair
+{
+    uint32_t left;
+    uint32_t right;
+    float distance;
+};
+
+struct MatchOptions
+{
+    float distance = BUCKET_SIZE * 0.5f;
+    // Hash bounds of both grids, see Grid::bounds.
+    vec3 bounds = hash_bounds;
+    // Ratio test, each side's nearest must be at most 'ratio' times as far
+    // as its second nearest. One keeps every mutual pair.
+    float ratio = 1.0f;
+};
+
+// Pairs whose points are each other's nearest neighbour in the other cloud
+// within 'options.distance' and pass the ratio test on both sides, ordered
+// by left index. Both directions are searched in one parallel pass over
+// grids of the same cell size, then intersected in a single pass over the
+// left results. Indices in the pairs are input indices of 'left' and
+// 'right'.
+std::vector<MatchPair> MutualNearest(
+    const vec3* left,
+    const size_t left_count,
+    const vec3* right,
+    const size_t right_count,
+    const MatchOptions& options);
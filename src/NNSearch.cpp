@@ -0,0 +1,342 @@
+#include "NNSearch.h"
+
+#include "Grid.hpp"
+
+#include <memory>
+#include <new>
+
+struct nn_index
+{
+    Grid grid;
+    float radius;
+};
+
+struct nn_cancel
+{
+    CancelToken token;
+};
+
+static inline bool valid_positions(const nn_positions* positions, const size_t count)
+{
+    return count == 0 || (positions &&
+        positions->x && positions->y && positions->z);
+}
+
+static inline StridedPositions strided(const nn_positions* positions)
+{
+    return positions ?
+        StridedPositions(positions->x, positions->y, positions->z, positions->stride) :
+        StridedPositions();
+}
+
+static inline SearchOptions search_options(const nn_search_options* options)
+{
+    SearchOptions search;
+    if (options)
+    {
+        search.epsilon = options->epsilon;
+        search.max_candidates = options->max_candidates;
+    }
+    return search;
+}
+
+static inline const CancelToken* cancel_token(const nn_search_options* options)
+{
+    return options && options->cancel ? &options->cancel->token : nullptr;
+}
+
+// Runs 'call', mapping exceptions to a status since none may cross the C
+// boundary.
+template <typename Call>
+static nn_status guarded(const Call& call)
+{
+    try
+    {
+        return call();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return NN_OUT_OF_MEMORY;
+    }
+    catch (...)
+    {
+        return NN_INTERNAL_ERROR;
+    }
+}
+
+// Writes the result of a search, neighbours beyond the radius are not
+// reported even when a shared bucket turned them up.
+static inline void put_result(
+    const GridView& grid,
+    const Nearest& found,
+    const float radius,
+    uint32_t& nearest,
+    float* distance)
+{
+    const bool within = found.found && found.distance <= radius;
+
+    nearest = within ? grid.indices[found.index] : NN_NONE;
+
+    if (distance)
+    {
+        *distance = within ? found.distance : std::numeric_limits<float>::max();
+    }
+}
+
+// Per query costs, refined as searches run so small batches stay on the
+// calling thread.
+static ConcurrentCost nearest_cost(200.0f);
+static ConcurrentCost self_cost(200.0f);
+static ConcurrentCost any_within_cost(100.0f);
+
+void nn_index_options_init(nn_index_options* options)
+{
+    options->radius = BUCKET_SIZE * 0.5f;
+    options->bounds[0] = 0.0f;
+    options->bounds[1] = 0.0f;
+    options->bounds[2] = 0.0f;
+    options->bucket_count = 0;
+}
+
+void nn_search_options_init(nn_search_options* options)
+{
+    options->epsilon = 0.0f;
+    options->max_candidates = std::numeric_limits<uint32_t>::max();
+    options->cancel = nullptr;
+    options->completed = nullptr;
+}
+
+nn_status nn_cancel_create(nn_cancel** cancel)
+{
+    if (!cancel)
+    {
+        return NN_INVALID_ARGUMENT;
+    }
+
+    *cancel = new (std::nothrow) nn_cancel;
+    return *cancel ? NN_OK : NN_OUT_OF_MEMORY;
+}
+
+void nn_cancel_destroy(nn_cancel* cancel)
+{
+    delete cancel;
+}
+
+void nn_cancel_request(nn_cancel* cancel)
+{
+    if (cancel)
+    {
+        cancel->token.Cancel();
+    }
+}
+
+void nn_cancel_set_timeout(nn_cancel* cancel, double seconds)
+{
+    if (cancel)
+    {
+        // Clamped so huge and NaN timeouts cannot overflow the clock.
+        const double clamped = seconds > 0.0 ? std::min(seconds, 1e9) : 0.0;
+        cancel->token.SetTimeout(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(clamped)));
+    }
+}
+
+void nn_set_threads(uint32_t threads)
+{
+    concurrent_threads_limit() = threads;
+}
+
+uint32_t nn_get_threads(void)
+{
+    return concurrent_threads();
+}
+
+nn_status nn_index_create(
+    const nn_positions* positions,
+    size_t count,
+    const nn_index_options* options,
+    nn_index** index)
+{
+    if (!index || !options || !valid_positions(positions, count) ||
+        !(options->radius > 0.0f) ||
+        count > std::numeric_limits<uint32_t>::max() ||
+        options->bucket_count == 1 ||
+        (options->bucket_count & (options->bucket_count - 1)) != 0)
+    {
+        return NN_INVALID_ARGUMENT;
+    }
+
+    *index = nullptr;
+
+    const vec3 bounds =
+        options->bounds[0] == 0.0f &&
+        options->bounds[1] == 0.0f &&
+        options->bounds[2] == 0.0f ?
+        hash_bounds :
+        vec3(options->bounds[0], options->bounds[1], options->bounds[2]);
+
+    return guarded([&]
+    {
+        std::unique_ptr<nn_index> created(new nn_index
+        {
+            Grid(
+                options->radius * 2.0f,
+                options->bucket_count > 0 ?
+                    options->bucket_count : fib_calc_bucket_count(count),
+                bounds),
+            options->radius
+        });
+
+        created->grid.Build(strided(positions), count);
+        *index = created.release();
+        return NN_OK;
+    });
+}
+
+void nn_index_destroy(nn_index* index)
+{
+    delete index;
+}
+
+size_t nn_index_size(const nn_index* index)
+{
+    return index ? index->grid.Size() : 0;
+}
+
+nn_status nn_search_nearest(
+    const nn_index* index,
+    const nn_positions* queries,
+    size_t count,
+    const nn_search_options* options,
+    uint32_t* nearest,
+    float* distances)
+{
+    if (!index || !valid_positions(queries, count) || (count > 0 && !nearest))
+    {
+        return NN_INVALID_ARGUMENT;
+    }
+
+    const GridView& grid = index->grid;
+    const StridedPositions input = strided(queries);
+    const SearchOptions search = search_options(options);
+    uint8_t* completed = options ? options->completed : nullptr;
+
+    return guarded([&]
+    {
+        const bool finished = ResolveCancellable([&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; i++)
+            {
+                const Nearest found = grid.FindNearest(
+                    input[i],
+                    std::numeric_limits<uint32_t>::max(),
+                    search);
+
+                put_result(
+                    grid,
+                    found,
+                    index->radius,
+                    nearest[i],
+                    distances ? &distances[i] : nullptr);
+            }
+
+            if (completed)
+            {
+                std::fill(completed + i0, completed + i1, 1);
+            }
+        },
+        [&](size_t i0, size_t i1)
+        {
+            if (completed)
+            {
+                std::fill(completed + i0, completed + i1, 0);
+            }
+        },
+        count, cancel_token(options), nearest_cost);
+
+        return finished ? NN_OK : NN_CANCELLED;
+    });
+}
+
+nn_status nn_search_self(
+    const nn_index* index,
+    const nn_search_options* options,
+    uint32_t* nearest,
+    float* distances)
+{
+    if (!index || (index->grid.Size() > 0 && !nearest))
+    {
+        return NN_INVALID_ARGUMENT;
+    }
+
+    const GridView& grid = index->grid;
+    const SearchOptions search = search_options(options);
+    const size_t count = grid.Size();
+    uint8_t* completed = options ? options->completed : nullptr;
+
+    return guarded([&]
+    {
+        const bool finished = ResolveCancellable([&](size_t k0, size_t k1)
+        {
+            // Sorted order for locality, scattered back to input order.
+            for (size_t k = k0; k < k1; k++)
+            {
+                const uint32_t k32 = static_cast<uint32_t>(k);
+                const Nearest found = grid.FindNearest(grid.positions[k], k32, search);
+                const uint32_t i = grid.indices[k];
+
+                put_result(
+                    grid,
+                    found,
+                    index->radius,
+                    nearest[i],
+                    distances ? &distances[i] : nullptr);
+
+                if (completed)
+                {
+                    completed[i] = 1;
+                }
+            }
+        },
+        [&](size_t k0, size_t k1)
+        {
+            for (size_t k = k0; completed && k < k1; k++)
+            {
+                completed[grid.indices[k]] = 0;
+            }
+        },
+        count, cancel_token(options), self_cost);
+
+        return finished ? NN_OK : NN_CANCELLED;
+    });
+}
+
+nn_status nn_search_any_within(
+    const nn_index* index,
+    const nn_positions* queries,
+    size_t count,
+    float radius,
+    uint8_t* hits)
+{
+    if (!index || !valid_positions(queries, count) || (count > 0 && !hits) ||
+        radius < 0.0f || radius > index->radius)
+    {
+        return NN_INVALID_ARGUMENT;
+    }
+
+    const GridView& grid = index->grid;
+    const StridedPositions input = strided(queries);
+
+    return guarded([&]
+    {
+        ResolveConcurrent([&](uint32_t start, uint32_t step)
+        {
+            for (size_t i = start; i < count; i += step)
+            {
+                hits[i] = grid.AnyWithin(input[i], radius) ? 1 : 0;
+            }
+        }, any_within_cost, count);
+
+        return NN_OK;
+    });
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+/* C API */
+
+// Plain C interface for embedding. Positions and queries are read in place
+// from caller memory through strides and results are written to caller
+// arrays, so the only memory allocated is the index itself: the points
+// sorted into buckets, their input indices and the bucket directory. That
+// one copy is what keeps each bucket's points contiguous for the searches,
+// so the positions passed to nn_index_create need not outlive the call.
+// Queries are never copied.
+//
+// No call lets a C++ exception escape, failures come back as nn_status.
+//
+// Indices passed in and out are input indices, positions of the i-th point
+// are at x + i * stride bytes, likewise y and z. For interleaved xyz floats
+// pass x = base, y = base + 1, z = base + 2 and stride = record size, for
+// separate arrays stride = sizeof(float).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(NNSEARCH_C_EXPORTS)
+#define NN_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define NN_API __declspec(dllimport)
+#else
+#define NN_API __attribute__((visibility("default")))
+#endif
+
+typedef enum nn_status
+{
+    NN_OK = 0,
+    NN_INVALID_ARGUMENT = 1,
+    NN_OUT_OF_MEMORY = 2,
+    // Stopped early, results of completed queries were written.
+    NN_CANCELLED = 3,
+    // An unexpected failure inside the library.
+    NN_INTERNAL_ERROR = 4
+} nn_status;
+
+typedef struct nn_positions
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    size_t stride;
+} nn_positions;
+
+typedef struct nn_index_options
+{
+    // Searches are exact up to this distance.
+    float radius;
+    // Added to positions before hashing so they are positive, keep it close
+    // to the extent of the cloud. Zero selects the default of 1024.
+    float bounds[3];
+    // Power of two of at least 2, zero sizes it from the point count.
+    uint32_t bucket_count;
+} nn_index_options;
+
+typedef struct nn_cancel nn_cancel;
+
+typedef struct nn_search_options
+{
+    // See SearchOptions, zero and UINT32_MAX are exact.
+    float epsilon;
+    uint32_t max_candidates;
+    // Checked between chunks of queries, NULL never stops.
+    const nn_cancel* cancel;
+    // Optional per query flags, 1 where the result was written, so a
+    // cancelled search can still use the queries it finished.
+    uint8_t* completed;
+} nn_search_options;
+
+// Result index of queries without a neighbour within the radius, their
+// distance is FLT_MAX.
+#define NN_NONE 0xffffffffu
+
+typedef struct nn_index nn_index;
+
+NN_API void nn_index_options_init(nn_index_options* options);
+NN_API void nn_search_options_init(nn_search_options* options);
+
+// Worker threads used by every call, zero uses all hardware threads.
+NN_API void nn_set_threads(uint32_t threads);
+NN_API uint32_t nn_get_threads(void);
+
+// Cancellation token for searches, reusable until cancelled. Requests and
+// timeouts may come from any thread while a search runs.
+NN_API nn_status nn_cancel_create(nn_cancel** cancel);
+NN_API void nn_cancel_destroy(nn_cancel* cancel);
+NN_API void nn_cancel_request(nn_cancel* cancel);
+// Stops searches once 'seconds' from now have passed.
+NN_API void nn_cancel_set_timeout(nn_cancel* cancel, double seconds);
+
+NN_API nn_status nn_index_create(
+    const nn_positions* positions,
+    size_t count,
+    const nn_index_options* options,
+    nn_index** index);
+
+NN_API void nn_index_destroy(nn_index* index);
+
+NN_API size_t nn_index_size(const nn_index* index);
+
+// Nearest indexed point of each query, 'distances' may be NULL.
+NN_API nn_status nn_search_nearest(
+    const nn_index* index,
+    const nn_positions* queries,
+    size_t count,
+    const nn_search_options* options,
+    uint32_t* nearest,
+    float* distances);
+
+// Nearest other indexed point of every indexed point, written in input
+// order to arrays of nn_index_size() entries. 'distances' may be NULL.
+NN_API nn_status nn_search_self(
+    const nn_index* index,
+    const nn_search_options* options,
+    uint32_t* nearest,
+    float* distances);
+
+// hits[i] is 1 when some indexed point lies within 'radius' of query i,
+// 'radius' at most the index radius.
+NN_API nn_status nn_search_any_within(
+    const nn_index* index,
+    const nn_positions* queries,
+    size_t count,
+    float radius,
+    uint8_t* hits);
+
+#ifdef __cplusplus
+}
+#endif
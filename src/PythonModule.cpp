@@ -0,0 +1,636 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "NNSearch.h"
+
+#include <cstring>
+#include <vector>
+
+/* Python module */
+
+// Bindings over the C API. Inputs are any (n, 3) float32 buffer, such as a
+// NumPy array, read in place through its strides. Results are Buffer
+// objects exposing the library's output arrays through the buffer protocol,
+// numpy.asarray() wraps them without a copy. The GIL is released while
+// building and searching.
+
+/* Buffer */
+
+struct BufferObject
+{
+    PyObject_HEAD
+    std::vector<char>* data;
+    const char* format;
+    Py_ssize_t itemsize;
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+};
+
+static void Buffer_dealloc(BufferObject* self)
+{
+    delete self->data;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static int Buffer_getbuffer(BufferObject* self, Py_buffer* view, int flags)
+{
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "results are read only");
+        view->obj = nullptr;
+        return -1;
+    }
+
+    view->obj = reinterpret_cast<PyObject*>(self);
+    view->buf = self->data->data();
+    view->len = static_cast<Py_ssize_t>(self->data->size());
+    view->readonly = 1;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(self->format) : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? self->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+
+    Py_INCREF(self);
+    return 0;
+}
+
+static Py_ssize_t Buffer_length(BufferObject* self)
+{
+    return self->shape[0];
+}
+
+static PyBufferProcs Buffer_as_buffer =
+{
+    reinterpret_cast<getbufferproc>(Buffer_getbuffer),
+    nullptr
+};
+
+static PySequenceMethods Buffer_as_sequence = {};
+
+static PyTypeObject BufferType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+// Uninitialized result of 'count' items, filled with the GIL released.
+template <typename T>
+static BufferObject* NewBuffer(const Py_ssize_t count, const char* format)
+{
+    std::vector<char>* data = nullptr;
+
+    try
+    {
+        data = new std::vector<char>(static_cast<size_t>(count) * sizeof(T));
+    }
+    catch (const std::bad_alloc&)
+    {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+
+    BufferObject* self = PyObject_New(BufferObject, &BufferType);
+
+    if (!self)
+    {
+        delete data;
+        return nullptr;
+    }
+
+    self->data = data;
+    self->format = format;
+    self->itemsize = sizeof(T);
+    self->shape[0] = count;
+    self->strides[0] = sizeof(T);
+    return self;
+}
+
+template <typename T>
+static T* BufferData(BufferObject* buffer)
+{
+    return reinterpret_cast<T*>(buffer->data->data());
+}
+
+/* Positions */
+
+// Views an (n, 3) float32 buffer as strided positions.
+static bool GetPositions(PyObject* object, Py_buffer* view, nn_positions* positions)
+{
+    if (PyObject_GetBuffer(object, view, PyBUF_RECORDS_RO) != 0)
+    {
+        return false;
+    }
+
+    const bool is_float =
+        view->itemsize == sizeof(float) &&
+        view->format &&
+        (std::strcmp(view->format, "f") == 0 ||
+         std::strcmp(view->format, "<f") == 0 ||
+         std::strcmp(view->format, "=f") == 0);
+
+    if (!is_float || view->ndim != 2 || view->shape[1] != 3)
+    {
+        PyErr_SetString(PyExc_ValueError, "expected an (n, 3) float32 array");
+        PyBuffer_Release(view);
+        return false;
+    }
+
+    if (view->strides[0] < 0 || view->strides[1] < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "negative strides are not supported");
+        PyBuffer_Release(view);
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(view->buf);
+    positions->x = reinterpret_cast<const float*>(base);
+    positions->y = reinterpret_cast<const float*>(base + view->strides[1]);
+    positions->z = reinterpret_cast<const float*>(base + view->strides[1] * 2);
+    positions->stride = static_cast<size_t>(view->strides[0]);
+    return true;
+}
+
+static bool CheckStatus(const nn_status status)
+{
+    switch (status)
+    {
+    case NN_OK:
+        return true;
+    case NN_OUT_OF_MEMORY:
+        PyErr_NoMemory();
+        return false;
+    case NN_CANCELLED:
+        // Only a timeout cancels searches started from Python.
+        PyErr_SetString(PyExc_TimeoutError, "search timed out");
+        return false;
+    case NN_INTERNAL_ERROR:
+        PyErr_SetString(PyExc_RuntimeError, "internal error");
+        return false;
+    default:
+        PyErr_SetString(PyExc_ValueError, "invalid argument");
+        return false;
+    }
+}
+
+/* Index */
+
+struct IndexObject
+{
+    PyObject_HEAD
+    nn_index* index;
+};
+
+static void Index_dealloc(IndexObject* self)
+{
+    nn_index_destroy(self->index);
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static int Index_init(IndexObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = { "points", "radius", "bounds", nullptr };
+
+    PyObject* points = nullptr;
+    PyObject* bounds = Py_None;
+    nn_index_options options;
+    nn_index_options_init(&options);
+
+    // Other threads may be searching a live index without the GIL, so it is
+    // never replaced.
+    if (self->index)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Index is already initialized");
+        return -1;
+    }
+
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "Of|O", const_cast<char**>(keywords),
+        &points, &options.radius, &bounds))
+    {
+        return -1;
+    }
+
+    if (bounds != Py_None &&
+        !PyArg_ParseTuple(bounds, "fff",
+            &options.bounds[0], &options.bounds[1], &options.bounds[2]))
+    {
+        return -1;
+    }
+
+    Py_buffer view;
+    nn_positions positions;
+
+    if (!GetPositions(points, &view, &positions))
+    {
+        return -1;
+    }
+
+    nn_index* index = nullptr;
+    nn_status status;
+
+    Py_BEGIN_ALLOW_THREADS
+    status = nn_index_create(
+        &positions,
+        static_cast<size_t>(view.shape[0]),
+        &options,
+        &index);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+
+    if (!CheckStatus(status))
+    {
+        return -1;
+    }
+
+    // A concurrent __init__ may have won while the GIL was released.
+    if (self->index)
+    {
+        nn_index_destroy(index);
+        PyErr_SetString(PyExc_RuntimeError, "Index is already initialized");
+        return -1;
+    }
+
+    self->index = index;
+    return 0;
+}
+
+static bool CheckIndex(IndexObject* self)
+{
+    if (!self->index)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "index is not built");
+        return false;
+    }
+    return true;
+}
+
+// Cancellation token of a search given a 'timeout', destroyed with it.
+struct SearchTimeout
+{
+    nn_cancel* cancel = nullptr;
+
+    ~SearchTimeout()
+    {
+        nn_cancel_destroy(cancel);
+    }
+};
+
+// 'timeout' is in seconds from now, None never stops.
+static bool SetTimeout(
+    PyObject* timeout,
+    SearchTimeout& search_timeout,
+    nn_search_options* options)
+{
+    if (timeout == Py_None)
+    {
+        return true;
+    }
+
+    const double seconds = PyFloat_AsDouble(timeout);
+
+    if (seconds == -1.0 && PyErr_Occurred())
+    {
+        return false;
+    }
+
+    if (!(seconds >= 0.0))
+    {
+        PyErr_SetString(PyExc_ValueError, "timeout must be a non negative number of seconds");
+        return false;
+    }
+
+    if (!CheckStatus(nn_cancel_create(&search_timeout.cancel)))
+    {
+        return false;
+    }
+
+    nn_cancel_set_timeout(search_timeout.cancel, seconds);
+    options->cancel = search_timeout.cancel;
+    return true;
+}
+
+static bool ParseSearchOptions(
+    PyObject* args,
+    PyObject* kwargs,
+    const char* format,
+    const char** keywords,
+    PyObject** queries,
+    nn_search_options* options,
+    SearchTimeout& search_timeout)
+{
+    nn_search_options_init(options);
+
+    PyObject* timeout = Py_None;
+
+    const bool parsed = queries ?
+        PyArg_ParseTupleAndKeywords(
+            args, kwargs, format, const_cast<char**>(keywords),
+            queries, &options->epsilon, &options->max_candidates, &timeout) != 0 :
+        PyArg_ParseTupleAndKeywords(
+            args, kwargs, format, const_cast<char**>(keywords),
+            &options->epsilon, &options->max_candidates, &timeout) != 0;
+
+    return parsed && SetTimeout(timeout, search_timeout, options);
+}
+
+static PyObject* Results(BufferObject* nearest, BufferObject* distances)
+{
+    PyObject* result = PyTuple_Pack(
+        2,
+        reinterpret_cast<PyObject*>(nearest),
+        reinterpret_cast<PyObject*>(distances));
+    Py_DECREF(nearest);
+    Py_DECREF(distances);
+    return result;
+}
+
+static PyObject* Index_nearest(IndexObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {
+        "queries", "epsilon", "max_candidates", "timeout", nullptr };
+
+    PyObject* queries = nullptr;
+    nn_search_options options;
+    SearchTimeout timeout;
+
+    if (!CheckIndex(self) ||
+        !ParseSearchOptions(args, kwargs, "O|fIO", keywords, &queries, &options, timeout))
+    {
+        return nullptr;
+    }
+
+    Py_buffer view;
+    nn_positions positions;
+
+    if (!GetPositions(queries, &view, &positions))
+    {
+        return nullptr;
+    }
+
+    const Py_ssize_t count = view.shape[0];
+    BufferObject* nearest = NewBuffer<uint32_t>(count, "I");
+    BufferObject* distances = nearest ? NewBuffer<float>(count, "f") : nullptr;
+
+    if (!distances)
+    {
+        Py_XDECREF(nearest);
+        PyBuffer_Release(&view);
+        return nullptr;
+    }
+
+    nn_status status;
+
+    Py_BEGIN_ALLOW_THREADS
+    status = nn_search_nearest(
+        self->index,
+        &positions,
+        static_cast<size_t>(count),
+        &options,
+        BufferData<uint32_t>(nearest),
+        BufferData<float>(distances));
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+
+    if (!CheckStatus(status))
+    {
+        Py_DECREF(nearest);
+        Py_DECREF(distances);
+        return nullptr;
+    }
+
+    return Results(nearest, distances);
+}
+
+static PyObject* Index_self_nearest(IndexObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = { "epsilon", "max_candidates", "timeout", nullptr };
+
+    nn_search_options options;
+    SearchTimeout timeout;
+
+    if (!CheckIndex(self) ||
+        !ParseSearchOptions(args, kwargs, "|fIO", keywords, nullptr, &options, timeout))
+    {
+        return nullptr;
+    }
+
+    const Py_ssize_t count = static_cast<Py_ssize_t>(nn_index_size(self->index));
+    BufferObject* nearest = NewBuffer<uint32_t>(count, "I");
+    BufferObject* distances = nearest ? NewBuffer<float>(count, "f") : nullptr;
+
+    if (!distances)
+    {
+        Py_XDECREF(nearest);
+        return nullptr;
+    }
+
+    nn_status status;
+
+    Py_BEGIN_ALLOW_THREADS
+    status = nn_search_self(
+        self->index,
+        &options,
+        BufferData<uint32_t>(nearest),
+        BufferData<float>(distances));
+    Py_END_ALLOW_THREADS
+
+    if (!CheckStatus(status))
+    {
+        Py_DECREF(nearest);
+        Py_DECREF(distances);
+        return nullptr;
+    }
+
+    return Results(nearest, distances);
+}
+
+static PyObject* Index_any_within(IndexObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = { "queries", "radius", nullptr };
+
+    PyObject* queries = nullptr;
+    float radius = 0.0f;
+
+    if (!CheckIndex(self) ||
+        !PyArg_ParseTupleAndKeywords(
+            args, kwargs, "Of", const_cast<char**>(keywords),
+            &queries, &radius))
+    {
+        return nullptr;
+    }
+
+    Py_buffer view;
+    nn_positions positions;
+
+    if (!GetPositions(queries, &view, &positions))
+    {
+        return nullptr;
+    }
+
+    const Py_ssize_t count = view.shape[0];
+    BufferObject* hits = NewBuffer<uint8_t>(count, "?");
+
+    if (!hits)
+    {
+        PyBuffer_Release(&view);
+        return nullptr;
+    }
+
+    nn_status status;
+
+    Py_BEGIN_ALLOW_THREADS
+    status = nn_search_any_within(
+        self->index,
+        &positions,
+        static_cast<size_t>(count),
+        radius,
+        BufferData<uint8_t>(hits));
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+
+    if (!CheckStatus(status))
+    {
+        Py_DECREF(hits);
+        return nullptr;
+    }
+
+    return reinterpret_cast<PyObject*>(hits);
+}
+
+static Py_ssize_t Index_length(IndexObject* self)
+{
+    return static_cast<Py_ssize_t>(nn_index_size(self->index));
+}
+
+static PyMethodDef Index_methods[] =
+{
+    {
+        "nearest",
+        reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)(void)>(Index_nearest)),
+        METH_VARARGS | METH_KEYWORDS,
+        "nearest(queries, epsilon=0, max_candidates=2**32-1, timeout=None)\n"
+        "    -> (indices, distances)\n"
+        "Nearest indexed point of each query, index NONE and distance FLT_MAX\n"
+        "when none lies within the radius. Raises TimeoutError when 'timeout'\n"
+        "seconds pass first."
+    },
+    {
+        "self_nearest",
+        reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)(void)>(Index_self_nearest)),
+        METH_VARARGS | METH_KEYWORDS,
+        "self_nearest(epsilon=0, max_candidates=2**32-1, timeout=None)\n"
+        "    -> (indices, distances)\n"
+        "Nearest other indexed point of every indexed point, in input order,\n"
+        "NONE and timeout as for nearest."
+    },
+    {
+        "any_within",
+        reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)(void)>(Index_any_within)),
+        METH_VARARGS | METH_KEYWORDS,
+        "any_within(queries, radius) -> hits\n"
+        "Whether any indexed point lies within 'radius' of each query."
+    },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PySequenceMethods Index_as_sequence = {};
+
+static PyTypeObject IndexType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+/* Module */
+
+static PyObject* set_threads(PyObject*, PyObject* args)
+{
+    unsigned int threads = 0;
+
+    if (!PyArg_ParseTuple(args, "I", &threads))
+    {
+        return nullptr;
+    }
+
+    nn_set_threads(threads);
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_threads(PyObject*, PyObject*)
+{
+    return PyLong_FromUnsignedLong(nn_get_threads());
+}
+
+static PyMethodDef module_methods[] =
+{
+    {
+        "set_threads", set_threads, METH_VARARGS,
+        "set_threads(n)\nWorker threads used by every call, 0 uses all."
+    },
+    {
+        "get_threads", get_threads, METH_NOARGS,
+        "get_threads() -> n"
+    },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyModuleDef module_definition =
+{
+    PyModuleDef_HEAD_INIT,
+    "nnsearch",
+    "Fixed radius nearest neighbour search over float32 point arrays.",
+    -1,
+    module_methods
+};
+
+PyMODINIT_FUNC PyInit_nnsearch(void)
+{
+    Buffer_as_sequence.sq_length = reinterpret_cast<lenfunc>(Buffer_length);
+
+    BufferType.tp_name = "nnsearch.Buffer";
+    BufferType.tp_basicsize = sizeof(BufferObject);
+    BufferType.tp_dealloc = reinterpret_cast<destructor>(Buffer_dealloc);
+    BufferType.tp_as_buffer = &Buffer_as_buffer;
+    BufferType.tp_as_sequence = &Buffer_as_sequence;
+    BufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+    BufferType.tp_doc = "Result array, wrap with numpy.asarray() or memoryview().";
+
+    Index_as_sequence.sq_length = reinterpret_cast<lenfunc>(Index_length);
+
+    IndexType.tp_name = "nnsearch.Index";
+    IndexType.tp_basicsize = sizeof(IndexObject);
+    IndexType.tp_dealloc = reinterpret_cast<destructor>(Index_dealloc);
+    IndexType.tp_as_sequence = &Index_as_sequence;
+    IndexType.tp_flags = Py_TPFLAGS_DEFAULT;
+    IndexType.tp_doc =
+        "Index(points, radius, bounds=None)\n"
+        "Grid over an (n, 3) float32 array, searches are exact up to 'radius'.\n"
+        "'bounds' is added before hashing, keep it close to the cloud extent.\n"
+        "An Index is initialized once, calling __init__ again raises RuntimeError.";
+    IndexType.tp_methods = Index_methods;
+    IndexType.tp_init = reinterpret_cast<initproc>(Index_init);
+    IndexType.tp_new = PyType_GenericNew;
+
+    if (PyType_Ready(&BufferType) < 0 || PyType_Ready(&IndexType) < 0)
+    {
+        return nullptr;
+    }
+
+    PyObject* module = PyModule_Create(&module_definition);
+
+    if (!module)
+    {
+        return nullptr;
+    }
+
+    Py_INCREF(&BufferType);
+    Py_INCREF(&IndexType);
+
+    if (PyModule_AddObject(module, "Buffer", reinterpret_cast<PyObject*>(&BufferType)) < 0 ||
+        PyModule_AddObject(module, "Index", reinterpret_cast<PyObject*>(&IndexType)) < 0)
+    {
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    PyModule_AddIntConstant(module, "NONE", static_cast<long>(NN_NONE));
+    return module;
+}
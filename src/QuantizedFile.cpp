@@ -0,0 +1,617 @@
+#include "QuantizedFile.hpp"
+
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+/* Varints */
+
+static inline void put_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (uint32_t shift = 0; p < end && shift < 64; shift += 7)
+    {
+        const uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint64_t zigzag(const int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static inline int64_t unzigzag(const uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/* rANS */
+
+// Order 0 byte rANS with 12 bit probabilities, after
+// https://github.com/rygorous/ryg_rans
+
+const uint32_t rans_prob_bits = 12;
+const uint32_t rans_prob_scale = 1u << rans_prob_bits;
+const uint32_t rans_low = 1u << 23;
+const size_t rans_table_size = 256 * sizeof(uint16_t);
+
+static void NormalizeFrequencies(const uint8_t* data, const size_t size, uint16_t* freq)
+{
+    std::vector<uint64_t> counts(256, 0);
+    for (size_t i = 0; i < size; i++)
+    {
+        counts[data[i]]++;
+    }
+
+    uint32_t total = 0;
+    uint32_t largest = 0;
+
+    for (uint32_t s = 0; s < 256; s++)
+    {
+        freq[s] = 0;
+        if (counts[s] > 0)
+        {
+            // Every present symbol keeps a non zero probability.
+            freq[s] = static_cast<uint16_t>(std::max<uint64_t>(
+                1,
+                counts[s] * rans_prob_scale / size));
+            total += freq[s];
+            largest = counts[s] > counts[largest] ? s : largest;
+        }
+    }
+
+    // Rounding error goes to the most frequent symbol, which can afford it.
+    while (total > rans_prob_scale)
+    {
+        uint32_t victim = largest;
+        if (freq[victim] <= 1)
+        {
+            for (uint32_t s = 0; s < 256; s++)
+            {
+                victim = freq[s] > freq[victim] ? s : victim;
+            }
+        }
+        freq[victim]--;
+        total--;
+    }
+    freq[largest] = static_cast<uint16_t>(freq[largest] + rans_prob_scale - total);
+}
+
+static void RansEncode(
+    const std::vector<uint8_t>& data,
+    std::vector<uint8_t>& out)
+{
+    uint16_t freq[256];
+    uint32_t cum[257];
+
+    out.assign(rans_table_size, 0);
+
+    if (data.empty())
+    {
+        return;
+    }
+
+    NormalizeFrequencies(data.data(), data.size(), freq);
+    std::memcpy(out.data(), freq, rans_table_size);
+
+    cum[0] = 0;
+    for (uint32_t s = 0; s < 256; s++)
+    {
+        cum[s + 1] = cum[s] + freq[s];
+    }
+
+    // Encoded back to front, so the decoder reads forwards.
+    std::vector<uint8_t> stream(data.size() + 16);
+    uint8_t* end = stream.data() + stream.size();
+    uint8_t* p = end;
+    uint32_t x = rans_low;
+
+    for (size_t i = data.size(); i-- > 0;)
+    {
+        const uint32_t s = data[i];
+        const uint32_t x_max = ((rans_low >> rans_prob_bits) << 8) * freq[s];
+
+        while (x >= x_max)
+        {
+            if (p == stream.data())
+            {
+                // Incompressible, the caller stores varints instead.
+                out.clear();
+                return;
+            }
+            *--p = static_cast<uint8_t>(x);
+            x >>= 8;
+        }
+
+        x = ((x / freq[s]) << rans_prob_bits) + (x % freq[s]) + cum[s];
+    }
+
+    if (p - stream.data() < 4)
+    {
+        out.clear();
+        return;
+    }
+
+    p -= 4;
+    p[0] = static_cast<uint8_t>(x);
+    p[1] = static_cast<uint8_t>(x >> 8);
+    p[2] = static_cast<uint8_t>(x >> 16);
+    p[3] = static_cast<uint8_t>(x >> 24);
+
+    out.insert(out.end(), p, end);
+}
+
+static bool RansDecode(
+    const uint8_t* data,
+    const size_t size,
+    const size_t raw_size,
+    std::vector<uint8_t>& out)
+{
+    out.resize(raw_size);
+
+    if (raw_size == 0)
+    {
+        return true;
+    }
+
+    if (size < rans_table_size + 4)
+    {
+        return false;
+    }
+
+    uint16_t freq[256];
+    uint32_t cum[257];
+    std::memcpy(freq, data, rans_table_size);
+
+    cum[0] = 0;
+    for (uint32_t s = 0; s < 256; s++)
+    {
+        cum[s + 1] = cum[s] + freq[s];
+    }
+
+    if (cum[256] != rans_prob_scale)
+    {
+        return false;
+    }
+
+    uint8_t symbols[rans_prob_scale];
+    for (uint32_t s = 0; s < 256; s++)
+    {
+        std::memset(symbols + cum[s], static_cast<int>(s), freq[s]);
+    }
+
+    const uint8_t* p = data + rans_table_size;
+    const uint8_t* end = data + size;
+
+    uint32_t x =
+        static_cast<uint32_t>(p[0]) |
+        static_cast<uint32_t>(p[1]) << 8 |
+        static_cast<uint32_t>(p[2]) << 16 |
+        static_cast<uint32_t>(p[3]) << 24;
+    p += 4;
+
+    // The encoder keeps its state in [rans_low, rans_low << 8), a stream
+    // that leaves that range or runs dry early was not written by it.
+    if (x < rans_low || x >= rans_low << 8)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < raw_size; i++)
+    {
+        const uint32_t slot = x & (rans_prob_scale - 1);
+        const uint8_t s = symbols[slot];
+        out[i] = s;
+
+        x = freq[s] * (x >> rans_prob_bits) + slot - cum[s];
+
+        while (x < rans_low)
+        {
+            if (p == end)
+            {
+                return false;
+            }
+            x = (x << 8) | *p++;
+        }
+    }
+
+    // Decoding ends where encoding started, with every byte consumed.
+    return x == rans_low && p == end;
+}
+
+/* Writer */
+
+struct QuantizedPoint
+{
+    int64_t q[3];
+    int64_t cell[3];
+    uint32_t index;
+};
+
+// Shared by writer and reader so both hash the exact same floats.
+static inline vec3 dequantize(const int64_t q[3], const double precision, const vec3 bounds)
+{
+    return vec3(
+        q[0] * precision,
+        q[1] * precision,
+        q[2] * precision) - bounds;
+}
+
+bool WriteQuantizedFile(
+    const char* path,
+    const GridView& source,
+    const QuantizeOptions& options)
+{
+    const double precision = options.precision;
+    const double cell_steps = source.cell_size / precision;
+    const size_t count = source.Size();
+
+    // Quantized in input order.
+    std::vector<int64_t> quantized(count * 3);
+    std::vector<vec3> dequantized(count);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t k = start; k < count; k += step)
+        {
+            const uint32_t i = source.indices[k];
+            const vec3 p = source.positions[k] + source.bounds;
+            for (int a = 0; a < 3; a++)
+            {
+                quantized[i * 3 + a] = static_cast<int64_t>(
+                    std::llround(static_cast<double>(p[a]) / precision));
+            }
+            dequantized[i] = dequantize(&quantized[i * 3], precision, source.bounds);
+        }
+    });
+
+    // Points close to a cell face can round into the neighbouring cell, so
+    // the stored order is that of the decoded positions.
+    Grid grid(source.cell_size, source.bucket_count, source.bounds);
+    grid.Build(dequantized.data(), count);
+
+    // Blocks of whole buckets, at least one point each.
+    const uint32_t block_points = std::max<uint32_t>(options.block_points, 1);
+    std::vector<QuantizedBlock> blocks;
+    for (uint32_t b = 0; b < grid.bucket_count;)
+    {
+        QuantizedBlock block;
+        std::memset(&block, 0, sizeof(block));
+        block.first_bucket = b;
+        block.point_start = grid.buckets_start[b];
+
+        while (b < grid.bucket_count &&
+               grid.buckets_start[b] - block.point_start < block_points)
+        {
+            b++;
+        }
+
+        block.last_bucket = b;
+        block.point_count = grid.buckets_start[b] - block.point_start;
+        blocks.push_back(block);
+    }
+
+    std::vector<std::vector<uint8_t>> payloads(blocks.size());
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        std::vector<QuantizedPoint> points;
+        std::vector<uint8_t> raw;
+
+        for (size_t n = start; n < blocks.size(); n += step)
+        {
+            QuantizedBlock& block = blocks[n];
+            raw.clear();
+
+            for (uint32_t b = block.first_bucket; b < block.last_bucket; b++)
+            {
+                const uint32_t k0 = grid.buckets_start[b];
+                const uint32_t k1 = grid.buckets_start[b + 1];
+
+                put_varint(raw, k1 - k0);
+
+                // Points of one cell end up adjacent and sorted along x,
+                // so their deltas are small.
+                points.resize(k1 - k0);
+                for (uint32_t k = k0; k < k1; k++)
+                {
+                    QuantizedPoint& point = points[k - k0];
+                    point.index = grid.indices[k];
+                    for (int a = 0; a < 3; a++)
+                    {
+                        point.q[a] = quantized[point.index * 3 + a];
+                        point.cell[a] = static_cast<int64_t>(
+                            std::floor(point.q[a] / cell_steps));
+                    }
+                }
+
+                std::sort(points.begin(), points.end(),
+                    [](const QuantizedPoint& a, const QuantizedPoint& b)
+                    {
+                        return
+                            std::tie(a.cell[0], a.cell[1], a.cell[2], a.q[0]) <
+                            std::tie(b.cell[0], b.cell[1], b.cell[2], b.q[0]);
+                    });
+
+                int64_t previous[3] = { 0, 0, 0 };
+                int64_t previous_index = 0;
+
+                for (auto& point : points)
+                {
+                    for (int a = 0; a < 3; a++)
+                    {
+                        put_varint(raw, zigzag(point.q[a] - previous[a]));
+                        previous[a] = point.q[a];
+                    }
+
+                    if (options.store_indices)
+                    {
+                        put_varint(raw, zigzag(point.index - previous_index));
+                        previous_index = point.index;
+                    }
+                }
+            }
+
+            std::vector<uint8_t>& payload = payloads[n];
+            RansEncode(raw, payload);
+
+            block.raw_size = static_cast<uint32_t>(raw.size());
+
+            if (payload.empty() || payload.size() >= raw.size())
+            {
+                payload = raw;
+                block.codec = QUANTIZED_VARINT;
+            }
+            else
+            {
+                block.codec = QUANTIZED_RANS;
+            }
+
+            block.size = static_cast<uint32_t>(payload.size());
+        }
+    });
+
+    QuantizedFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "NNQC", 4);
+    header.version = quantized_file_version;
+    header.cell_size = grid.cell_size;
+    header.bounds[0] = grid.bounds.x;
+    header.bounds[1] = grid.bounds.y;
+    header.bounds[2] = grid.bounds.z;
+    header.bucket_count = grid.bucket_count;
+    header.block_count = static_cast<uint32_t>(blocks.size());
+    header.point_count = grid.Size();
+    header.precision = precision;
+    header.flags = options.store_indices ? QUANTIZED_INDICES : 0;
+
+    uint64_t offset = sizeof(header) + blocks.size() * sizeof(QuantizedBlock);
+    for (size_t n = 0; n < blocks.size(); n++)
+    {
+        blocks[n].offset = offset;
+        offset += payloads[n].size();
+    }
+
+    FILE* file = std::fopen(path, "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    bool written =
+        std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(blocks.data(), sizeof(QuantizedBlock), blocks.size(), file) ==
+            blocks.size();
+
+    for (size_t n = 0; written && n < payloads.size(); n++)
+    {
+        written = std::fwrite(payloads[n].data(), 1, payloads[n].size(), file) ==
+            payloads[n].size();
+    }
+
+    written &= std::fclose(file) == 0;
+    return written;
+}
+
+/* Reader */
+
+bool LoadQuantizedFile(const char* path, Grid& grid)
+{
+    MappedFile file(path);
+
+    if (!file.IsOpen() || file.Size() < sizeof(QuantizedFileHeader))
+    {
+        return false;
+    }
+
+    QuantizedFileHeader header;
+    std::memcpy(&header, file.Data(), sizeof(header));
+
+    const uint64_t directory_end = sizeof(header) +
+        static_cast<uint64_t>(header.block_count) * sizeof(QuantizedBlock);
+
+    if (std::memcmp(header.magic, "NNQC", 4) != 0 ||
+        header.version != quantized_file_version ||
+        header.bucket_count < 2 ||
+        (header.bucket_count & (header.bucket_count - 1)) != 0 ||
+        header.point_count > std::numeric_limits<uint32_t>::max() ||
+        !(header.cell_size > 0.0f) ||
+        !(header.precision > 0.0) ||
+        header.block_count == 0 ||
+        directory_end > file.Size())
+    {
+        return false;
+    }
+
+    std::vector<QuantizedBlock> blocks(header.block_count);
+    std::memcpy(
+        blocks.data(),
+        file.Data() + sizeof(header),
+        blocks.size() * sizeof(QuantizedBlock));
+
+    const size_t count = static_cast<size_t>(header.point_count);
+
+    // Blocks must tile the buckets and the points in order, so every
+    // bucket start is written once and they come out monotonic. A point
+    // takes at most four varints and a bucket one, which bounds what a
+    // block may claim to decode to.
+    uint32_t next_bucket = 0;
+    uint64_t next_point = 0;
+
+    for (const QuantizedBlock& block : blocks)
+    {
+        const uint64_t raw_limit =
+            static_cast<uint64_t>(block.point_count) * 4 * 10 +
+            static_cast<uint64_t>(block.last_bucket - block.first_bucket) * 10;
+
+        const bool in_order =
+            block.first_bucket == next_bucket &&
+            block.last_bucket >= block.first_bucket &&
+            block.last_bucket <= header.bucket_count &&
+            block.point_start == next_point &&
+            block.point_count <= count - next_point &&
+            block.offset <= file.Size() &&
+            block.size <= file.Size() - block.offset &&
+            block.raw_size <= raw_limit &&
+            (block.codec == QUANTIZED_RANS ||
+             (block.codec == QUANTIZED_VARINT && block.raw_size == block.size));
+
+        if (!in_order)
+        {
+            return false;
+        }
+
+        next_bucket = block.last_bucket;
+        next_point += block.point_count;
+    }
+
+    if (next_bucket != header.bucket_count || next_point != count)
+    {
+        return false;
+    }
+    const bool has_indices = (header.flags & QUANTIZED_INDICES) != 0;
+    const vec3 bounds = vec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+
+    std::vector<vec3> positions(count);
+    std::vector<uint32_t> bucket_ids(count);
+    std::vector<uint32_t> indices(count);
+    std::vector<uint32_t> buckets_start(header.bucket_count + 1, 0);
+    buckets_start[header.bucket_count] = static_cast<uint32_t>(count);
+
+    std::atomic<bool> valid(true);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        std::vector<uint8_t> decoded;
+
+        for (size_t n = start; n < blocks.size() && valid; n += step)
+        {
+            const QuantizedBlock& block = blocks[n];
+            const uint8_t* data = file.Data() + block.offset;
+            const uint8_t* p = data;
+            const uint8_t* end = data + block.size;
+
+            if (block.codec == QUANTIZED_RANS)
+            {
+                if (!RansDecode(data, block.size, block.raw_size, decoded))
+                {
+                    valid = false;
+                    break;
+                }
+                p = decoded.data();
+                end = p + decoded.size();
+            }
+
+            uint32_t k = block.point_start;
+            const uint32_t k_end = block.point_start + block.point_count;
+
+            for (uint32_t b = block.first_bucket; b < block.last_bucket; b++)
+            {
+                uint64_t bucket_points = 0;
+                if (!get_varint(p, end, bucket_points) ||
+                    bucket_points > k_end - k)
+                {
+                    valid = false;
+                    break;
+                }
+
+                buckets_start[b] = k;
+
+                // Sums wrap rather than overflow on corrupt deltas.
+                uint64_t previous[3] = { 0, 0, 0 };
+                uint64_t previous_index = 0;
+
+                for (uint64_t i = 0; i < bucket_points && valid; i++, k++)
+                {
+                    for (int a = 0; a < 3; a++)
+                    {
+                        uint64_t delta = 0;
+                        valid = valid && get_varint(p, end, delta);
+                        previous[a] += static_cast<uint64_t>(unzigzag(delta));
+                    }
+
+                    if (has_indices)
+                    {
+                        uint64_t delta = 0;
+                        valid = valid && get_varint(p, end, delta);
+                        previous_index += static_cast<uint64_t>(unzigzag(delta));
+                        valid = valid && previous_index < count;
+                    }
+
+                    const int64_t q[3] = {
+                        static_cast<int64_t>(previous[0]),
+                        static_cast<int64_t>(previous[1]),
+                        static_cast<int64_t>(previous[2])
+                    };
+
+                    positions[k] = dequantize(q, header.precision, bounds);
+                    bucket_ids[k] = b;
+                    indices[k] = has_indices ?
+                        static_cast<uint32_t>(previous_index) : k;
+                }
+
+                if (!valid)
+                {
+                    break;
+                }
+            }
+
+            if (k != k_end)
+            {
+                valid = false;
+            }
+        }
+    });
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    grid = Grid(header.cell_size, header.bucket_count, bounds);
+    grid.Assign(
+        std::move(positions),
+        std::move(bucket_ids),
+        std::move(indices),
+        std::move(buckets_start));
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Grid.hpp"
+
+/* Quantized point file */
+
+// Lossy archive of a grid. Positions are quantized to 'precision' steps from
+// the grid's hash origin, stored in bucket order with points of a bucket
+// ordered by cell, delta coded as varints and then rANS entropy coded in
+// independent blocks of whole buckets.
+//
+// Layout, little endian:
+//   QuantizedFileHeader
+//   QuantizedBlock per block
+//   block payloads
+
+const uint32_t quantized_file_version = 1;
+
+struct QuantizedFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    float cell_size;
+    float bounds[3];
+    uint32_t bucket_count;
+    uint32_t block_count;
+    uint64_t point_count;
+    double precision;
+    // QUANTIZED_INDICES when input indices are stored.
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+const uint32_t QUANTIZED_INDICES = 1;
+
+enum QuantizedCodec : uint32_t
+{
+    QUANTIZED_VARINT = 0,
+    // 256 uint16 frequencies then the rANS stream of the varint bytes.
+    QUANTIZED_RANS = 1
+};
+
+struct QuantizedBlock
+{
+    uint32_t first_bucket;
+    uint32_t last_bucket;
+    uint32_t point_start;
+    uint32_t point_count;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t raw_size;
+    uint32_t codec;
+    uint32_t reserved;
+};
+
+struct QuantizeOptions
+{
+    // Largest error per axis is half of this, plus float rounding.
+    double precision = 0.001;
+    // Points per independently decoded block, rounded up to whole buckets.
+    uint32_t block_points = 65536;
+    // Keep the input index of every point, otherwise the grid's input
+    // order becomes the file's bucket order.
+    bool store_indices = true;
+};
+
+bool WriteQuantizedFile(
+    const char* path,
+    const GridView& grid,
+    const QuantizeOptions& options = QuantizeOptions());
+
+// Replaces 'grid' with the file's grid, decoding blocks in parallel straight
+// into bucket order. Returns false when the file could not be read.
+bool LoadQuantizedFile(const char* path, Grid& grid);
@@ -0,0 +1,185 @@
+#include "RadixSort.hpp"
+
+#include <cstring>
+#include <functional>
+
+// Entries held per digit before they are written out, a cache line of keys.
+const uint32_t radix_buffer_entries = 8;
+// Fewer points per worker are not worth a slice.
+const size_t radix_min_slice = 1 << 16;
+
+template <typename Value>
+void RadixSort(std::vector<uint64_t>& keys, std::vector<Value>& values)
+{
+    const size_t count = keys.size();
+
+    if (count < 2)
+    {
+        return;
+    }
+
+    const uint32_t slices = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(
+        concurrent_threads(),
+        count / radix_min_slice)));
+
+    const auto slice_begin = [&](uint32_t t)
+    {
+        return count * t / slices;
+    };
+
+    // Workers are reused for every phase of every pass.
+    std::function<void(uint32_t)> phase;
+
+#ifdef CONCURRENT
+    WorkerPool workers;
+
+    for (uint32_t n = 0; n < slices; ++n)
+    {
+        workers.AddWorker(std::make_unique<Worker>([&phase, n]
+        {
+            phase(n);
+        }));
+    }
+#endif
+
+    const auto run = [&](std::function<void(uint32_t)>&& job)
+    {
+        phase = std::move(job);
+#ifdef CONCURRENT
+        workers.Resolve();
+#else
+        for (uint32_t n = 0; n < slices; ++n)
+        {
+            phase(n);
+        }
+#endif
+    };
+
+    // Bits that differ between any two keys, passes over the rest are
+    // skipped.
+    std::vector<uint64_t> slice_or(slices, 0);
+    std::vector<uint64_t> slice_and(slices, ~0ull);
+
+    run([&](uint32_t t)
+    {
+        uint64_t any = 0;
+        uint64_t all = ~0ull;
+        for (size_t i = slice_begin(t); i < slice_begin(t + 1); i++)
+        {
+            any |= keys[i];
+            all &= keys[i];
+        }
+        slice_or[t] = any;
+        slice_and[t] = all;
+    });
+
+    uint64_t varying = 0;
+    uint64_t constant = ~0ull;
+    for (uint32_t t = 0; t < slices; t++)
+    {
+        varying |= slice_or[t];
+        constant &= slice_and[t];
+    }
+    varying &= ~constant;
+
+    std::vector<uint64_t> scratch_keys(count);
+    std::vector<Value> scratch_values(count);
+
+    uint64_t* src_keys = keys.data();
+    Value* src_values = values.data();
+    uint64_t* dst_keys = scratch_keys.data();
+    Value* dst_values = scratch_values.data();
+
+    // Per slice digit counts, then write offsets.
+    std::vector<size_t> offsets(slices * radix_size);
+
+    for (uint32_t shift = 0; shift < 64; shift += radix_bits)
+    {
+        if (((varying >> shift) & (radix_size - 1)) == 0)
+        {
+            continue;
+        }
+
+        run([&](uint32_t t)
+        {
+            size_t* histogram = &offsets[t * radix_size];
+            std::fill(histogram, histogram + radix_size, 0);
+
+            for (size_t i = slice_begin(t); i < slice_begin(t + 1); i++)
+            {
+                histogram[(src_keys[i] >> shift) & (radix_size - 1)]++;
+            }
+        });
+
+        // Digit major, slice minor, so equal keys keep their order.
+        size_t offset = 0;
+        for (uint32_t d = 0; d < radix_size; d++)
+        {
+            for (uint32_t t = 0; t < slices; t++)
+            {
+                const size_t n = offsets[t * radix_size + d];
+                offsets[t * radix_size + d] = offset;
+                offset += n;
+            }
+        }
+
+        run([&](uint32_t t)
+        {
+            size_t* offset = &offsets[t * radix_size];
+
+            std::vector<uint64_t> key_buffer(radix_size * radix_buffer_entries);
+            std::vector<Value> value_buffer(radix_size * radix_buffer_entries);
+            std::vector<uint32_t> fill(radix_size, 0);
+
+            const auto flush = [&](uint32_t d, uint32_t n)
+            {
+                std::memcpy(
+                    dst_keys + offset[d],
+                    &key_buffer[d * radix_buffer_entries],
+                    n * sizeof(uint64_t));
+                std::memcpy(
+                    dst_values + offset[d],
+                    &value_buffer[d * radix_buffer_entries],
+                    n * sizeof(Value));
+                offset[d] += n;
+            };
+
+            for (size_t i = slice_begin(t); i < slice_begin(t + 1); i++)
+            {
+                const uint64_t key = src_keys[i];
+                const uint32_t d = static_cast<uint32_t>(key >> shift) & (radix_size - 1);
+                const uint32_t n = fill[d];
+
+                key_buffer[d * radix_buffer_entries + n] = key;
+                value_buffer[d * radix_buffer_entries + n] = src_values[i];
+
+                if (n + 1 == radix_buffer_entries)
+                {
+                    flush(d, radix_buffer_entries);
+                    fill[d] = 0;
+                }
+                else
+                {
+                    fill[d] = n + 1;
+                }
+            }
+
+            for (uint32_t d = 0; d < radix_size; d++)
+            {
+                flush(d, fill[d]);
+            }
+        });
+
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+    }
+
+    if (src_keys != keys.data())
+    {
+        keys.swap(scratch_keys);
+        values.swap(scratch_values);
+    }
+}
+
+template void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values);
+template void RadixSort(std::vector<uint64_t>& keys, std::vector<uint64_t>& values);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <vector>
+
+/* Radix sort */
+
+// Parallel stable LSD radix sort of 64 bit keys carrying a value each.
+// Digits are 'radix_bits' wide, passes whose digit is equal for every key
+// are skipped. Each worker sorts a contiguous slice through its own
+// histogram and scatters through small per digit buffers written out a
+// cache line at a time, so stores do not thrash the cache across 2048
+// destinations.
+
+const uint32_t radix_bits = 11;
+const uint32_t radix_size = 1u << radix_bits;
+
+// Defined for uint32_t and uint64_t values.
+template <typename Value>
+void RadixSort(std::vector<uint64_t>& keys, std::vector<Value>& values);
+
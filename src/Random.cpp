@@ -0,0 +1,45 @@
+#include "Random.hpp"
+
+void GenerateUniformRange(
+    vec3* points,
+    const uint64_t first,
+    const uint64_t last,
+    const uint64_t seed,
+    const vec3 low,
+    const vec3 high)
+{
+    const vec3 extent = high - low;
+    // Largest floats below 'high', rounding can otherwise reach it.
+    const vec3 top = vec3(
+        std::nextafter(high.x, low.x),
+        std::nextafter(high.y, low.y),
+        std::nextafter(high.z, low.z));
+
+    for (uint64_t i = first; i < last; i++)
+    {
+        const vec3 p = low + uniform_point(seed, i) * extent;
+        points[i - first] = glm::min(p, top);
+    }
+}
+
+void GenerateUniformPoints(
+    vec3* points,
+    const size_t count,
+    const uint64_t seed,
+    const vec3 low,
+    const vec3 high,
+    const uint64_t first)
+{
+    static ConcurrentCost cost(10.0f);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        // The generator is counter based, so each worker starts its own
+        // range at its first index.
+        const size_t slice = (count + step - 1) / step;
+        const size_t i0 = std::min(count, slice * start);
+        const size_t i1 = std::min(count, i0 + slice);
+
+        GenerateUniformRange(points + i0, first + i0, first + i1, seed, low, high);
+    }, cost, count);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <array>
+
+/* Counter based random numbers */
+
+// Philox4x32-10 from "Parallel random numbers: as easy as 1, 2, 3"
+// (Salmon et al. 2011). Output is a pure function of key and counter, so
+// any range of points can be generated independently by any thread and
+// the cloud is identical for every thread count.
+
+const uint32_t philox_m0 = 0xD2511F53u;
+const uint32_t philox_m1 = 0xCD9E8D57u;
+const uint32_t philox_w0 = 0x9E3779B9u;
+const uint32_t philox_w1 = 0xBB67AE85u;
+
+inline std::array<uint32_t, 4> philox4x32(
+    std::array<uint32_t, 4> counter,
+    std::array<uint32_t, 2> key)
+{
+    for (uint32_t round = 0; round < 10; round++)
+    {
+        const uint64_t p0 = static_cast<uint64_t>(philox_m0) * counter[0];
+        const uint64_t p1 = static_cast<uint64_t>(philox_m1) * counter[2];
+
+        counter =
+        {
+            static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+            static_cast<uint32_t>(p1),
+            static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+            static_cast<uint32_t>(p0)
+        };
+
+        key[0] += philox_w0;
+        key[1] += philox_w1;
+    }
+    return counter;
+}
+
+// Top 24 bits to a float in [0, 1).
+inline float uniform_float(const uint32_t bits)
+{
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// Point 'index' of the cloud of 'seed', uniform in [0, 1)^3.
+inline vec3 uniform_point(const uint64_t seed, const uint64_t index)
+{
+    const std::array<uint32_t, 4> bits = philox4x32(
+        {
+            static_cast<uint32_t>(index),
+            static_cast<uint32_t>(index >> 32),
+            0u,
+            0u
+        },
+        {
+            static_cast<uint32_t>(seed),
+            static_cast<uint32_t>(seed >> 32)
+        });
+
+    return vec3(
+        uniform_float(bits[0]),
+        uniform_float(bits[1]),
+        uniform_float(bits[2]));
+}
+
+// Fills points[0, last - first) with points [first, last) of the cloud of
+// 'seed', uniform in the box [low, high), on the calling thread.
+void GenerateUniformRange(
+    vec3* points,
+    const uint64_t first,
+    const uint64_t last,
+    const uint64_t seed,
+    const vec3 low,
+    const vec3 high);
+
+// Fills points [first, first + count) of the cloud of 'seed', uniform in
+// the box [low, high), in parallel.
+void GenerateUniformPoints(
+    vec3* points,
+    const size_t count,
+    const uint64_t seed,
+    const vec3 low,
+    const vec3 high,
+    const uint64_t first = 0);
@@ -0,0 +1,530 @@
+#include "ResultWriter.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/* Output file */
+
+class OutputFile
+{
+private:
+    int file_ = -1;
+
+public:
+    OutputFile(const char* path)
+    {
+#ifdef _WIN32
+        file_ = _open(
+            path,
+            _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+            _S_IREAD | _S_IWRITE);
+#else
+        file_ = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    }
+
+    ~OutputFile()
+    {
+        Close();
+    }
+
+    bool IsOpen() const
+    {
+        return file_ >= 0;
+    }
+
+    bool Close()
+    {
+        if (file_ < 0)
+        {
+            return true;
+        }
+#ifdef _WIN32
+        const bool closed = _close(file_) == 0;
+#else
+        const bool closed = close(file_) == 0;
+#endif
+        file_ = -1;
+        return closed;
+    }
+
+    // Writes the buffers back to back, as few system calls as possible.
+    bool Write(const std::vector<std::vector<char>>& buffers, const size_t* sizes)
+    {
+#ifdef _WIN32
+        for (size_t b = 0; b < buffers.size(); b++)
+        {
+            const char* data = buffers[b].data();
+            size_t remaining = sizes[b];
+            while (remaining > 0)
+            {
+                const unsigned n = static_cast<unsigned>(
+                    std::min<size_t>(remaining, 1u << 30));
+                const int written = _write(file_, data, n);
+                if (written <= 0)
+                {
+                    return false;
+                }
+                data += written;
+                remaining -= static_cast<size_t>(written);
+            }
+        }
+        return true;
+#else
+        std::vector<iovec> vectors;
+        for (size_t b = 0; b < buffers.size(); b++)
+        {
+            if (sizes[b] > 0)
+            {
+                vectors.push_back({
+                    const_cast<char*>(buffers[b].data()),
+                    sizes[b]
+                });
+            }
+        }
+
+        size_t v = 0;
+        while (v < vectors.size())
+        {
+            const int n = static_cast<int>(
+                std::min<size_t>(vectors.size() - v, IOV_MAX));
+            ssize_t written = writev(file_, &vectors[v], n);
+            if (written < 0)
+            {
+                return false;
+            }
+
+            // Skip what went out, partial writes resume mid buffer.
+            while (v < vectors.size() &&
+                   static_cast<size_t>(written) >= vectors[v].iov_len)
+            {
+                written -= static_cast<ssize_t>(vectors[v].iov_len);
+                v++;
+            }
+            if (v < vectors.size())
+            {
+                vectors[v].iov_base =
+                    static_cast<char*>(vectors[v].iov_base) + written;
+                vectors[v].iov_len -= static_cast<size_t>(written);
+            }
+        }
+        return true;
+#endif
+    }
+};
+
+/* Formatting */
+
+static inline char* format_uint(char* out, uint64_t value)
+{
+    char digits[20];
+    int n = 0;
+    do
+    {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    while (value != 0);
+
+    while (n > 0)
+    {
+        *out++ = digits[--n];
+    }
+    return out;
+}
+
+// Nine significant digits in scientific notation, as "%.9g" prints values
+// of a billion and up in the C locale. Enough to round trip any float.
+static char* format_scientific(char* out, double v)
+{
+    if (v < 0.0)
+    {
+        *out++ = '-';
+        v = -v;
+    }
+
+    int exponent = static_cast<int>(std::floor(std::log10(v)));
+    uint64_t digits = static_cast<uint64_t>(v / std::pow(10.0, exponent - 8) + 0.5);
+
+    // log10 and the rounding can each land one digit off.
+    if (digits >= 1000000000)
+    {
+        digits = (digits + 5) / 10;
+        exponent++;
+    }
+    else if (digits < 100000000)
+    {
+        digits = static_cast<uint64_t>(v / std::pow(10.0, exponent - 9) + 0.5);
+        exponent--;
+    }
+
+    char mantissa[9];
+    for (int d = 9; d-- > 0;)
+    {
+        mantissa[d] = static_cast<char>('0' + digits % 10);
+        digits /= 10;
+    }
+
+    int length = 9;
+    while (length > 1 && mantissa[length - 1] == '0')
+    {
+        length--;
+    }
+
+    *out++ = mantissa[0];
+    if (length > 1)
+    {
+        *out++ = '.';
+        std::memcpy(out, mantissa + 1, length - 1);
+        out += length - 1;
+    }
+
+    *out++ = 'e';
+    *out++ = exponent < 0 ? '-' : '+';
+    const uint32_t magnitude = static_cast<uint32_t>(exponent < 0 ? -exponent : exponent);
+    if (magnitude < 10)
+    {
+        *out++ = '0';
+    }
+    return format_uint(out, magnitude);
+}
+
+// Fixed point, very large values in scientific notation. Never goes
+// through printf so the output does not depend on the locale.
+static inline char* format_float(
+    char* out,
+    const float value,
+    const uint32_t decimals,
+    const uint64_t scale)
+{
+    double v = value;
+
+    if (std::isnan(v))
+    {
+        std::memcpy(out, "nan", 3);
+        return out + 3;
+    }
+
+    if (std::isinf(v))
+    {
+        if (v < 0.0)
+        {
+            *out++ = '-';
+        }
+        std::memcpy(out, "inf", 3);
+        return out + 3;
+    }
+
+    if (!(std::fabs(v) * static_cast<double>(scale) < 1e18))
+    {
+        return format_scientific(out, v);
+    }
+
+    if (v < 0.0)
+    {
+        *out++ = '-';
+        v = -v;
+    }
+
+    const uint64_t fixed = static_cast<uint64_t>(v * scale + 0.5);
+    out = format_uint(out, fixed / scale);
+
+    if (decimals > 0)
+    {
+        *out++ = '.';
+        uint64_t fraction = fixed % scale;
+        for (uint32_t d = decimals; d-- > 0;)
+        {
+            out[d] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        out += decimals;
+    }
+    return out;
+}
+
+static char* format_binary_row(
+    char* out,
+    const ResultColumns& columns,
+    const size_t row)
+{
+    const auto put = [&](const void* value)
+    {
+        std::memcpy(out, value, 4);
+        out += 4;
+    };
+
+    if (columns.positions)
+    {
+        put(&columns.positions[row].x);
+        put(&columns.positions[row].y);
+        put(&columns.positions[row].z);
+    }
+    if (columns.nearest)
+    {
+        put(&columns.nearest[row]);
+    }
+    if (columns.distances)
+    {
+        put(&columns.distances[row]);
+    }
+    for (auto& attribute : columns.attributes)
+    {
+        put(&attribute.values[row]);
+    }
+    return out;
+}
+
+static size_t binary_row_size(const ResultColumns& columns)
+{
+    return 4 * (
+        (columns.positions ? 3 : 0) +
+        (columns.nearest ? 1 : 0) +
+        (columns.distances ? 1 : 0) +
+        columns.attributes.size());
+}
+
+/* Writer */
+
+// Formats rows with 'format' in parallel chunks of at most 'max_row_size'
+// bytes per row and writes them after 'header'.
+template <typename Format>
+static bool WriteRows(
+    const char* path,
+    const std::string& header,
+    const size_t count,
+    const size_t max_row_size,
+    const ResultWriteOptions& options,
+    const Format& format)
+{
+    OutputFile file(path);
+
+    if (!file.IsOpen())
+    {
+        return false;
+    }
+
+    const uint32_t threads = concurrent_threads();
+    const size_t chunk_rows = std::max<uint32_t>(options.chunk_rows, 1);
+
+    // The header rides along in the first buffer of the first round.
+    std::vector<std::vector<char>> buffers(threads + 1);
+    std::vector<size_t> sizes(threads + 1, 0);
+    buffers[0].assign(header.begin(), header.end());
+    sizes[0] = header.size();
+
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        buffers[t + 1].resize(chunk_rows * max_row_size);
+    }
+
+    size_t round_start = 0;
+
+    const auto format_chunk = [&](uint32_t t)
+    {
+        const size_t r0 = std::min(count, round_start + t * chunk_rows);
+        const size_t r1 = std::min(count, r0 + chunk_rows);
+
+        char* begin = buffers[t + 1].data();
+        char* out = begin;
+        for (size_t row = r0; row < r1; row++)
+        {
+            out = format(out, row);
+        }
+        sizes[t + 1] = static_cast<size_t>(out - begin);
+    };
+
+#ifdef CONCURRENT
+    WorkerPool workers;
+    for (uint32_t t = 0; t < threads; t++)
+    {
+        workers.AddWorker(std::make_unique<Worker>([&, t]
+        {
+            format_chunk(t);
+        }));
+    }
+#endif
+
+    bool written = true;
+
+    do
+    {
+#ifdef CONCURRENT
+        workers.Resolve();
+#else
+        format_chunk(0);
+#endif
+
+        written = file.Write(buffers, sizes.data());
+        sizes[0] = 0;
+        round_start += threads * chunk_rows;
+    }
+    while (written && round_start < count);
+
+    return file.Close() && written;
+}
+
+bool WriteResultsBinary(
+    const char* path,
+    const ResultColumns& columns,
+    const ResultWriteOptions& options)
+{
+    return WriteRows(
+        path,
+        std::string(),
+        columns.count,
+        binary_row_size(columns),
+        options,
+        [&](char* out, size_t row)
+        {
+            return format_binary_row(out, columns, row);
+        });
+}
+
+bool WriteResultsCsv(
+    const char* path,
+    const ResultColumns& columns,
+    const ResultWriteOptions& options)
+{
+    // More digits than this cannot be exact for a float anyway.
+    const uint32_t decimals = std::min<uint32_t>(options.decimals, 9);
+    uint64_t scale = 1;
+    for (uint32_t d = 0; d < decimals; d++)
+    {
+        scale *= 10;
+    }
+
+    std::string header;
+    const auto add_name = [&](const char* name)
+    {
+        header += header.empty() ? "" : ",";
+        header += name;
+    };
+
+    if (columns.positions)
+    {
+        add_name("x");
+        add_name("y");
+        add_name("z");
+    }
+    if (columns.nearest)
+    {
+        add_name("nearest");
+    }
+    if (columns.distances)
+    {
+        add_name("distance");
+    }
+    for (auto& attribute : columns.attributes)
+    {
+        add_name(attribute.name);
+    }
+    header += "\n";
+
+    // Floats print at most 32 bytes, uint32 at most 10, plus separators.
+    const size_t max_row_size =
+        (columns.positions ? 3 * 33 : 0) +
+        (columns.nearest ? 11 : 0) +
+        (columns.distances ? 33 : 0) +
+        columns.attributes.size() * 11 + 1;
+
+    return WriteRows(
+        path,
+        header,
+        columns.count,
+        max_row_size,
+        options,
+        [&](char* out, size_t row)
+        {
+            char* begin = out;
+            const auto separator = [&]
+            {
+                if (out != begin)
+                {
+                    *out++ = ',';
+                }
+            };
+
+            if (columns.positions)
+            {
+                const vec3 p = columns.positions[row];
+                out = format_float(out, p.x, decimals, scale);
+                *out++ = ',';
+                out = format_float(out, p.y, decimals, scale);
+                *out++ = ',';
+                out = format_float(out, p.z, decimals, scale);
+            }
+            if (columns.nearest)
+            {
+                separator();
+                out = format_uint(out, columns.nearest[row]);
+            }
+            if (columns.distances)
+            {
+                separator();
+                out = format_float(out, columns.distances[row], decimals, scale);
+            }
+            for (auto& attribute : columns.attributes)
+            {
+                separator();
+                out = format_uint(out, attribute.values[row]);
+            }
+            *out++ = '\n';
+            return out;
+        });
+}
+
+bool WriteResultsPly(
+    const char* path,
+    const ResultColumns& columns,
+    const ResultWriteOptions& options)
+{
+    std::string header =
+        "ply\n"
+        "format binary_little_endian 1.0\n"
+        "element vertex " + std::to_string(columns.count) + "\n";
+
+    if (columns.positions)
+    {
+        header +=
+            "property float x\n"
+            "property float y\n"
+            "property float z\n";
+    }
+    if (columns.nearest)
+    {
+        header += "property uint nearest\n";
+    }
+    if (columns.distances)
+    {
+        header += "property float distance\n";
+    }
+    for (auto& attribute : columns.attributes)
+    {
+        header += "property uint " + std::string(attribute.name) + "\n";
+    }
+    header += "end_header\n";
+
+    return WriteRows(
+        path,
+        header,
+        columns.count,
+        binary_row_size(columns),
+        options,
+        [&](char* out, size_t row)
+        {
+            return format_binary_row(out, columns, row);
+        });
+}
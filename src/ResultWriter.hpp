@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <vector>
+
+/* Result writers */
+
+struct ResultAttribute
+{
+    const char* name;
+    const uint32_t* values;
+};
+
+// Columns of per point results, null columns are left out of the output.
+struct ResultColumns
+{
+    size_t count = 0;
+    const vec3* positions = nullptr;
+    const uint32_t* nearest = nullptr;
+    const float* distances = nullptr;
+    std::vector<ResultAttribute> attributes;
+};
+
+struct ResultWriteOptions
+{
+    // Rows formatted by one worker before its buffer is written.
+    uint32_t chunk_rows = 65536;
+    // Fraction digits of floats in CSV.
+    uint32_t decimals = 6;
+};
+
+// Rows are formatted in parallel, one chunk per worker into a buffer sized
+// up front, then each round of buffers goes out in one vectored write.
+// All return false when the file could not be written.
+
+// Packed little endian rows: x, y, z float, nearest uint32, distance float,
+// then the attributes as uint32.
+bool WriteResultsBinary(
+    const char* path,
+    const ResultColumns& columns,
+    const ResultWriteOptions& options = ResultWriteOptions());
+
+bool WriteResultsCsv(
+    const char* path,
+    const ResultColumns& columns,
+    const ResultWriteOptions& options = ResultWriteOptions());
+
+// Binary little endian PLY with one vertex element holding the same
+// properties as WriteResultsBinary.
+bool WriteResultsPly(
+    const char* path,
+    const ResultColumns& columns,
+    const ResultWriteOptions& options = ResultWriteOptions());
@@ -0,0 +1,124 @@
+#include "Reverse.hpp"
+
+InfluenceSpheres BuildInfluenceSpheres(
+    const GridView& grid,
+    const float* nearest_distances)
+{
+    const size_t count = grid.Size();
+    const float radius = grid.cell_size * 0.5f;
+
+    InfluenceSpheres spheres;
+    spheres.radii2.resize(count);
+    spheres.bucket_radii2.assign(grid.bucket_count, 0.0f);
+
+    // Whole buckets per worker so each bucket maximum has one writer.
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (uint32_t b = start; b < grid.bucket_count; b += step)
+        {
+            float bucket_radius2 = 0.0f;
+
+            for (uint32_t k = grid.buckets_start[b]; k < grid.buckets_start[b + 1]; k++)
+            {
+                // Neighbours past the radius are only found when they share
+                // a bucket, a nearer one may be missed, so cap it there.
+                const float distance = nearest_distances ?
+                    nearest_distances[grid.indices[k]] :
+                    grid.FindNearest(grid.positions[k], k).distance;
+                const float r = std::min(distance, radius);
+
+                spheres.radii2[k] = r * r;
+                bucket_radius2 = std::max(bucket_radius2, r * r);
+            }
+
+            spheres.bucket_radii2[b] = bucket_radius2;
+        }
+    });
+
+    return spheres;
+}
+
+// Calls visit(sorted index) for each point whose sphere holds 'pos'.
+template <typename Visit>
+static inline void visit_reverse(
+    const GridView& grid,
+    const InfluenceSpheres& spheres,
+    const vec3 pos,
+    const Visit& visit)
+{
+    const float radius = grid.cell_size * 0.5f;
+
+    uint32_t buckets[8];
+    float bounds2[8];
+    const uint32_t bucket_count =
+        grid.OrderedNeighbourBuckets(pos, buckets, bounds2);
+
+    for (uint32_t j = 0; j < bucket_count; j++)
+    {
+        if (bounds2[j] > radius * radius)
+        {
+            break;
+        }
+
+        if (bounds2[j] > spheres.bucket_radii2[buckets[j]])
+        {
+            continue;
+        }
+
+        const uint32_t k1 = grid.buckets_start[buckets[j] + 1];
+
+        for (uint32_t k = grid.buckets_start[buckets[j]]; k < k1; k++)
+        {
+            const vec3 d = grid.positions[k] - pos;
+            if (glm::dot(d, d) <= spheres.radii2[k])
+            {
+                visit(k);
+            }
+        }
+    }
+}
+
+ReverseNearestResult ReverseNearest(
+    const GridView& grid,
+    const InfluenceSpheres& spheres,
+    const vec3* queries,
+    const size_t count)
+{
+    ReverseNearestResult result;
+    result.offsets.assign(count + 1, 0);
+
+    // Counted first so every query writes its own range.
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t i = start; i < count; i += step)
+        {
+            size_t found = 0;
+            visit_reverse(grid, spheres, queries[i], [&](uint32_t)
+            {
+                found++;
+            });
+            result.offsets[i + 1] = found;
+        }
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+
+    result.points.resize(result.offsets[count]);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t i = start; i < count; i += step)
+        {
+            size_t n = result.offsets[i];
+            visit_reverse(grid, spheres, queries[i], [&](uint32_t k)
+            {
+                result.points[n++] = grid.indices[k];
+            });
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Grid.hpp"
+
+#include <vector>
+
+/* Reverse nearest neighbours */
+
+// Each indexed point's influence sphere reaches out to its nearest other
+// point, so a query inside it is at least as near as that neighbour. Radii
+// are capped at 'cell_size / 2', which keeps every sphere holding a query
+// within the query's neighbour buckets.
+struct InfluenceSpheres
+{
+    // Squared radius of each point in sorted order.
+    std::vector<float> radii2;
+    // Largest of 'radii2' in each bucket, buckets a query lies farther from
+    // are skipped.
+    std::vector<float> bucket_radii2;
+};
+
+// From the nearest distances of a self search in input order, as
+// nn_search_self returns them. Without them the self search is run here.
+InfluenceSpheres BuildInfluenceSpheres(
+    const GridView& grid,
+    const float* nearest_distances = nullptr);
+
+struct ReverseNearestResult
+{
+    // Input indices of the points query i is a nearest neighbour of, in
+    // points[offsets[i]] to points[offsets[i + 1]].
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> points;
+};
+
+// For each query, the indexed points that would take it as their nearest
+// neighbour, ties included. Exact for reverse neighbours within
+// 'cell_size / 2', farther ones are not reported.
+ReverseNearestResult ReverseNearest(
+    const GridView& grid,
+    const InfluenceSpheres& spheres,
+    const vec3* queries,
+    const size_t count);
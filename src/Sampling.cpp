@@ -0,0 +1,303 @@
+#include "Sampling.hpp"
+
+#include <algorithm>
+
+// Points of one occupied cell, contiguous in the sampling order.
+struct SamplingCell
+{
+    uint32_t x, y, z;
+    uint32_t begin, end;
+};
+
+// Cell coordinates of 'pos', as the grid hash computes them.
+static inline glm::uvec3 sampling_cell(const vec3 pos, const float cell_size, const vec3 bounds)
+{
+    const vec3 p = (pos + bounds) / cell_size;
+    return glm::uvec3(
+        static_cast<uint32_t>(p.x),
+        static_cast<uint32_t>(p.y),
+        static_cast<uint32_t>(p.z));
+}
+
+std::vector<uint32_t> FarthestPointSampling(
+    const vec3* points,
+    const size_t count,
+    const size_t samples,
+    const uint32_t first)
+{
+    std::vector<uint32_t> picks;
+
+    if (count == 0 || samples == 0 || first >= count)
+    {
+        return picks;
+    }
+
+    /* Cells */
+
+    vec3 low = points[0];
+    vec3 high = points[0];
+    for (size_t i = 1; i < count; i++)
+    {
+        low = glm::min(low, points[i]);
+        high = glm::max(high, points[i]);
+    }
+
+    // Sized as if the cloud filled its box, else its largest plane or line,
+    // whichever cells are largest.
+    vec3 extent = high - low;
+    std::sort(&extent[0], &extent[0] + 3);
+    const float per_point = static_cast<float>(sampling_points_per_cell) / count;
+    float cell_size = std::max({
+        std::cbrt(extent[0] * extent[1] * extent[2] * per_point),
+        std::sqrt(extent[1] * extent[2] * per_point),
+        extent[2] * per_point });
+    cell_size = cell_size > 0.0f ? cell_size : 1.0f;
+
+    const vec3 bounds = -low;
+    Grid grid(cell_size, fib_calc_bucket_count(count, sampling_points_per_cell), bounds);
+    grid.Build(points, count);
+
+    // Buckets hold cells that hash alike, sorted by cell so each cell is
+    // one run.
+    std::vector<uint32_t> order(count);
+    std::vector<glm::uvec3> order_cells(count);
+    for (uint32_t k = 0; k < count; k++)
+    {
+        order[k] = k;
+        order_cells[k] = sampling_cell(grid.positions[k], cell_size, bounds);
+    }
+
+    const auto cell_less = [](const glm::uvec3 a, const glm::uvec3 b)
+    {
+        return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+    };
+
+    std::vector<vec3> positions(count);
+    std::vector<uint32_t> indices(count);
+    std::vector<uint32_t> point_cells(count);
+    std::vector<SamplingCell> cells;
+    std::vector<uint32_t> bucket_cells(grid.bucket_count + 1, 0);
+    glm::uvec3 top(0);
+
+    for (uint32_t b = 0; b < grid.bucket_count; b++)
+    {
+        const uint32_t k0 = grid.buckets_start[b];
+        const uint32_t k1 = grid.buckets_start[b + 1];
+
+        std::sort(order.begin() + k0, order.begin() + k1, [&](uint32_t l, uint32_t r)
+        {
+            return cell_less(order_cells[l], order_cells[r]);
+        });
+
+        bucket_cells[b] = static_cast<uint32_t>(cells.size());
+
+        for (uint32_t j = k0; j < k1; j++)
+        {
+            const glm::uvec3 c = order_cells[order[j]];
+
+            if (j == k0 || c != order_cells[order[j - 1]])
+            {
+                cells.push_back({ c.x, c.y, c.z, j, j });
+                top = glm::max(top, c);
+            }
+
+            cells.back().end = j + 1;
+            positions[j] = grid.positions[order[j]];
+            indices[j] = grid.indices[order[j]];
+            point_cells[j] = static_cast<uint32_t>(cells.size() - 1);
+        }
+    }
+
+    bucket_cells[grid.bucket_count] = static_cast<uint32_t>(cells.size());
+
+    const uint32_t cell_count = static_cast<uint32_t>(cells.size());
+
+    /* Distances */
+
+    // Squared distance to the nearest pick, picks themselves are -1 so they
+    // are never picked again.
+    std::vector<float> distance2(count, std::numeric_limits<float>::max());
+    // Per cell largest distance2 and the point holding it, the extra entry
+    // is the empty slot of the max tree.
+    std::vector<float> cell_max2(cell_count + 1, -1.0f);
+    std::vector<uint32_t> cell_far(cell_count, 0);
+
+    for (uint32_t c = 0; c < cell_count; c++)
+    {
+        cell_max2[c] = std::numeric_limits<float>::max();
+        cell_far[c] = cells[c].begin;
+    }
+
+    // Max tree over cells, each node holds the cell with the largest bound
+    // below it.
+    uint32_t leaves = 1;
+    while (leaves < cell_count)
+    {
+        leaves *= 2;
+    }
+
+    std::vector<uint32_t> tree(leaves * 2, cell_count);
+    for (uint32_t c = 0; c < cell_count; c++)
+    {
+        tree[leaves + c] = c;
+    }
+
+    const auto tree_pick = [&](uint32_t n)
+    {
+        const uint32_t l = tree[n * 2];
+        const uint32_t r = tree[n * 2 + 1];
+        tree[n] = cell_max2[l] >= cell_max2[r] ? l : r;
+    };
+
+    for (uint32_t n = leaves; n-- > 1;)
+    {
+        tree_pick(n);
+    }
+
+    /* Sampling */
+
+    static ConcurrentCost update_cost(5.0f);
+
+    std::vector<uint32_t> affected;
+    std::vector<uint32_t> affected_stamp(cell_count, 0);
+
+    uint32_t pick = static_cast<uint32_t>(
+        std::find(indices.begin(), indices.end(), first) - indices.begin());
+
+    const size_t pick_count = std::min(samples, count);
+    picks.reserve(pick_count);
+
+    for (uint32_t s = 1; s <= pick_count; s++)
+    {
+        picks.push_back(indices[pick]);
+
+        const vec3 p0 = positions[pick];
+        const float reach2 = distance2[pick];
+        const float reach = std::sqrt(reach2);
+        distance2[pick] = -1.0f;
+
+        // Cells the pick's reach touches whose bound it could lower, a
+        // thousandth of a cell of slack covers rounding of cell membership.
+        const vec3 local = (p0 + bounds) / cell_size;
+        const float slack = 1e-3f;
+
+        const auto visit = [&](const uint32_t c)
+        {
+            const SamplingCell& cell = cells[c];
+            const vec3 box_low(cell.x, cell.y, cell.z);
+            const vec3 d = glm::max(
+                glm::max(box_low - local, local - (box_low + 1.0f)) - slack,
+                vec3(0.0f)) * cell_size;
+
+            if (glm::dot(d, d) < cell_max2[c])
+            {
+                affected_stamp[c] = s;
+                affected.push_back(c);
+            }
+        };
+
+        affected.clear();
+
+        const float reach_cells = reach / cell_size + slack;
+        const glm::uvec3 c0 = sampling_cell(
+            glm::max(p0 - reach_cells * cell_size, low), cell_size, bounds);
+        const glm::uvec3 c1 = glm::min(
+            sampling_cell(glm::min(p0 + reach_cells * cell_size, high), cell_size, bounds),
+            top);
+        const double cube =
+            (c1.x - c0.x + 1.0) * (c1.y - c0.y + 1.0) * (c1.z - c0.z + 1.0);
+
+        if (reach2 == std::numeric_limits<float>::max() || cube >= cell_count)
+        {
+            for (uint32_t c = 0; c < cell_count; c++)
+            {
+                visit(c);
+            }
+        }
+        else
+        {
+            for (uint32_t z = c0.z; z <= c1.z; z++)
+            {
+                for (uint32_t y = c0.y; y <= c1.y; y++)
+                {
+                    for (uint32_t x = c0.x; x <= c1.x; x++)
+                    {
+                        const uint32_t b = fib_hash_to_index(
+                            hash_cell(x, y, z),
+                            grid.bucket_shift);
+
+                        for (uint32_t c = bucket_cells[b]; c < bucket_cells[b + 1]; c++)
+                        {
+                            if (cells[c].x == x && cells[c].y == y && cells[c].z == z)
+                            {
+                                visit(c);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // The pick's own cell needs its bound redone even when nothing
+        // moves nearer.
+        if (affected_stamp[point_cells[pick]] != s)
+        {
+            affected_stamp[point_cells[pick]] = s;
+            affected.push_back(point_cells[pick]);
+        }
+
+        size_t affected_points = 0;
+        for (const uint32_t c : affected)
+        {
+            affected_points += cells[c].end - cells[c].begin;
+        }
+
+        ResolveConcurrent([&](uint32_t start, uint32_t step)
+        {
+            for (size_t a = start; a < affected.size(); a += step)
+            {
+                const uint32_t c = affected[a];
+                float max2 = -1.0f;
+                uint32_t far = cells[c].begin;
+
+                for (uint32_t j = cells[c].begin; j < cells[c].end; j++)
+                {
+                    const vec3 d = positions[j] - p0;
+                    distance2[j] = std::min(distance2[j], glm::dot(d, d));
+
+                    if (distance2[j] > max2)
+                    {
+                        max2 = distance2[j];
+                        far = j;
+                    }
+                }
+
+                cell_max2[c] = max2;
+                cell_far[c] = far;
+            }
+        }, update_cost, affected_points);
+
+        // Rebuilt whole once paths from most leaves would cost more.
+        if (affected.size() * 8 > cell_count)
+        {
+            for (uint32_t n = leaves; n-- > 1;)
+            {
+                tree_pick(n);
+            }
+        }
+        else
+        {
+            for (const uint32_t c : affected)
+            {
+                for (uint32_t n = (leaves + c) / 2; n >= 1; n /= 2)
+                {
+                    tree_pick(n);
+                }
+            }
+        }
+
+        pick = cell_far[tree[1]];
+    }
+
+    return picks;
+}
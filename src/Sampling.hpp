@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Grid.hpp"
+
+#include <vector>
+
+/* Farthest point sampling */
+
+// Points per cell of the sampling grid, if the cloud fills its bounding
+// box, plane or line.
+const uint32_t sampling_points_per_cell = 8;
+
+// Picks 'samples' points, each the farthest from those picked before,
+// starting with input index 'first'. Returns input indices in pick order.
+//
+// Every point keeps its distance to the nearest pick and every grid cell
+// the largest of those. A new pick only moves points nearer to it than
+// their current distance, which is at most the pick's own distance, so
+// only cells within that reach and whose bound it could lower are updated,
+// in parallel when worth it. The next pick comes from a max tree over the
+// cells.
+std::vector<uint32_t> FarthestPointSampling(
+    const vec3* points,
+    const size_t count,
+    const size_t samples,
+    const uint32_t first = 0);
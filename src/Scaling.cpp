@@ -0,0 +1,144 @@
+#include "Grid.hpp"
+#include "Random.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using hrc = std::chrono::high_resolution_clock;
+
+/* Parameters */
+
+// Just past 2^32 points so every index type boundary is crossed, needs
+// about 40 bytes per point, ~170GB.
+#define SCALING_POINTS ((1ull << 32) + (1ull << 24))
+#define SCALING_SEED 1
+#define SCALING_EXTENT 1000.0f
+
+/* Timing */
+
+inline hrc::time_point timer_start()
+{
+    return hrc::now();
+}
+
+inline float timer_end(hrc::time_point& timer_start_point)
+{
+    const auto time_span = std::chrono::duration_cast<std::chrono::duration<float>>(
+        hrc::now() - timer_start_point);
+    return time_span.count() * 1000;
+}
+
+/* Scaling */
+
+// Builds a grid of 'count' generated points, through the counting sort or
+// the radix sort, and searches every 'query_step'th of them. Each result is
+// checked by distance against the input point its index names, which fails
+// if indices were truncated.
+template <typename Index>
+void RunScaling(const size_t count, const size_t query_step, const bool radix)
+{
+    std::cout << "Points: " << count << ", ";
+    std::cout << sizeof(Index) * 8 << " bit indices, ";
+    std::cout << (radix ? "radix" : "counting") << " sort" << std::endl;
+
+    std::vector<vec3> input(count);
+
+    hrc::time_point generate_timer_start_point = timer_start();
+    GenerateUniformPoints(
+        input.data(),
+        count,
+        SCALING_SEED,
+        vec3(0.0f),
+        vec3(SCALING_EXTENT));
+    const float generate_time = timer_end(generate_timer_start_point);
+
+    BasicGrid<Index> grid(BUCKET_SIZE, fib_calc_bucket_count(count));
+
+    hrc::time_point sort_timer_start_point = timer_start();
+    if (radix)
+    {
+        grid.BuildRadix(input.data(), count);
+    }
+    else
+    {
+        grid.Build(input.data(), count);
+    }
+    const float sort_time = timer_end(sort_timer_start_point);
+
+    std::atomic<uint64_t> found(0);
+    std::atomic<uint64_t> found_high(0);
+    std::atomic<uint64_t> errors(0);
+
+    hrc::time_point search_timer_start_point = timer_start();
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        uint64_t local_found = 0;
+        uint64_t local_found_high = 0;
+        uint64_t local_errors = 0;
+
+        for (size_t k = start * query_step; k < count; k += step * query_step)
+        {
+            const Index k_index = static_cast<Index>(k);
+            const vec3 p0 = grid.positions[k];
+            const BasicNearest<Index> nearest = grid.FindNearest(p0, k_index);
+
+            if (nearest.found)
+            {
+                const Index i0 = grid.indices[k];
+                const Index i1 = grid.indices[nearest.index];
+
+                local_found++;
+                local_found_high += i1 > std::numeric_limits<uint32_t>::max() ? 1 : 0;
+                local_errors +=
+                    input[i0] != p0 ||
+                    glm::length(input[i1] - p0) != nearest.distance ? 1 : 0;
+            }
+        }
+
+        found += local_found;
+        found_high += local_found_high;
+        errors += local_errors;
+    });
+
+    const float search_time = timer_end(search_timer_start_point);
+
+    std::cout << "Found: " << found << ", beyond 2^32: " << found_high;
+    std::cout << ", index errors: " << errors << std::endl;
+    std::cout << "Generate time: " << generate_time << "ms." << std::endl;
+    std::cout << "Sort time: " << sort_time << "ms." << std::endl;
+    std::cout << "Search time: " << search_time << "ms." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    // nnsearch_scaling [points] [index bits] [query step] [counting|radix]
+    const size_t count = argc > 1 ?
+        static_cast<size_t>(std::stoull(argv[1])) : SCALING_POINTS;
+    const uint32_t index_bits = argc > 2 ?
+        static_cast<uint32_t>(std::stoul(argv[2])) :
+        count > std::numeric_limits<uint32_t>::max() ? 64 : 32;
+    const size_t query_step = argc > 3 ?
+        std::max<size_t>(1, std::stoull(argv[3])) : 1;
+    const bool radix = argc > 4 && std::string(argv[4]) == "radix";
+
+    if (index_bits == 32)
+    {
+        if (count > std::numeric_limits<uint32_t>::max())
+        {
+            std::cerr << "More than 2^32 - 1 points need 64 bit indices." << std::endl;
+            return 1;
+        }
+
+        RunScaling<uint32_t>(count, query_step, radix);
+    }
+    else
+    {
+        RunScaling<uint64_t>(count, query_step, radix);
+    }
+
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include "Scheduler.hpp"
+
+struct Scheduler::Job
+{
+    ChunkJob run;
+    const CancelToken* cancel = nullptr;
+    uint32_t chunks = 0;
+    // Next chunk to hand out.
+    uint32_t next = 0;
+    uint32_t finished = 0;
+};
+
+Scheduler::Scheduler(const uint32_t threads)
+{
+    for (uint32_t n = 0; n < std::max(threads, 1u); ++n)
+    {
+        threads_.emplace_back([this]
+        {
+            Loop();
+        });
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    work_.notify_all();
+
+    // Queued work still runs before the workers exit.
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+uint32_t Scheduler::AddTenant(const uint32_t weight)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Tenant tenant;
+    tenant.weight = std::max(weight, 1u);
+
+    // Start level with the others instead of catching up on past shares.
+    for (auto& other : tenants_)
+    {
+        tenant.pass = std::max(tenant.pass, other.pass);
+    }
+
+    tenants_.push_back(std::move(tenant));
+    return static_cast<uint32_t>(tenants_.size() - 1);
+}
+
+Scheduler::JobHandle Scheduler::Submit(
+    const uint32_t tenant,
+    const Priority priority,
+    const uint32_t chunks,
+    ChunkJob&& job,
+    const CancelToken* cancel)
+{
+    JobHandle handle = std::make_shared<Job>();
+    handle->run = std::move(job);
+    handle->cancel = cancel;
+    handle->chunks = chunks;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (tenant >= tenants_.size())
+        {
+            return nullptr;
+        }
+
+        if (chunks == 0)
+        {
+            return handle;
+        }
+
+        Tenant& owner = tenants_[tenant];
+        const uint32_t c = static_cast<uint32_t>(priority);
+
+        // An idle tenant does not bank shares while it has no work.
+        bool idle = true;
+        for (auto& jobs : owner.jobs)
+        {
+            idle &= jobs.empty();
+        }
+
+        if (idle)
+        {
+            double lowest = owner.pass;
+            bool any = false;
+            for (auto& other : tenants_)
+            {
+                bool active = false;
+                for (auto& jobs : other.jobs)
+                {
+                    active |= !jobs.empty();
+                }
+                if (active)
+                {
+                    lowest = any ? std::min(lowest, other.pass) : other.pass;
+                    any = true;
+                }
+            }
+            owner.pass = std::max(owner.pass, any ? lowest : owner.pass);
+        }
+
+        owner.jobs[c].push_back(handle);
+    }
+
+    if (chunks == 1)
+    {
+        work_.notify_one();
+    }
+    else
+    {
+        work_.notify_all();
+    }
+
+    return handle;
+}
+
+void Scheduler::Drop(std::deque<JobHandle>& jobs)
+{
+    // Stopped jobs leave the queue whole, chunks already running finish.
+    while (!jobs.empty() && jobs.front()->cancel && jobs.front()->cancel->Stopped())
+    {
+        Job& job = *jobs.front();
+        job.finished += job.chunks - job.next;
+        job.next = job.chunks;
+        jobs.pop_front();
+
+        if (job.finished == job.chunks)
+        {
+            done_.notify_all();
+        }
+    }
+}
+
+bool Scheduler::Next(JobHandle& job, uint32_t& chunk)
+{
+    for (uint32_t c = 0; c < priority_classes; c++)
+    {
+        Tenant* next = nullptr;
+
+        for (auto& tenant : tenants_)
+        {
+            Drop(tenant.jobs[c]);
+
+            if (!tenant.jobs[c].empty() && (!next || tenant.pass < next->pass))
+            {
+                next = &tenant;
+            }
+        }
+
+        if (next)
+        {
+            std::deque<JobHandle>& jobs = next->jobs[c];
+            job = jobs.front();
+            chunk = job->next++;
+
+            // Fully handed out, running chunks finish on their own.
+            if (job->next == job->chunks)
+            {
+                jobs.pop_front();
+            }
+
+            next->pass += 1.0 / next->weight;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Scheduler::Loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        JobHandle job;
+        uint32_t chunk = 0;
+
+        work_.wait(lock, [&]
+        {
+            return Next(job, chunk) || stopping_;
+        });
+
+        if (!job)
+        {
+            return;
+        }
+
+        lock.unlock();
+        job->run(chunk);
+        lock.lock();
+
+        if (++job->finished == job->chunks)
+        {
+            done_.notify_all();
+        }
+    }
+}
+
+void Scheduler::Wait(const JobHandle& job)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]
+    {
+        return !job || job->finished == job->chunks;
+    });
+}
+
+bool Scheduler::IsDone(const JobHandle& job)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !job || job->finished == job->chunks;
+}
+
+/* Scheduled grid operations */
+
+static uint32_t chunk_count(const size_t count)
+{
+    return static_cast<uint32_t>(
+        (count + scheduled_chunk_points - 1) / scheduled_chunk_points);
+}
+
+bool ScheduledBuild(
+    Scheduler& scheduler,
+    const uint32_t tenant,
+    Grid& grid,
+    const vec3* input,
+    const size_t count,
+    const Priority priority)
+{
+    // A slice per worker rather than per chunk, as each slice holds a
+    // histogram and scatter offsets of bucket_count entries.
+    const uint32_t slice_count = std::max(1u, std::min(concurrent_threads(), chunk_count(count)));
+    std::vector<GridSlice> slices(slice_count);
+
+    const auto slice_size = [&](const uint32_t t)
+    {
+        return count * (t + 1) / slice_count - count * t / slice_count;
+    };
+
+    const Scheduler::JobHandle sized = scheduler.Submit(tenant, priority, slice_count, [&](uint32_t t)
+    {
+        slices[t].bucket_ids.resize(slice_size(t));
+        slices[t].histogram.assign(grid.bucket_count, 0);
+    });
+
+    if (!sized)
+    {
+        return false;
+    }
+    scheduler.Wait(sized);
+
+    // Chunks of one slice share its histogram and offsets, so each round
+    // runs one chunk of every slice.
+    const size_t rounds = chunk_count((count + slice_count - 1) / slice_count);
+
+    const auto run_rounds = [&](const std::function<void(uint32_t, size_t, size_t)>& run)
+    {
+        for (size_t r = 0; r < rounds; r++)
+        {
+            scheduler.Wait(scheduler.Submit(tenant, priority, slice_count, [&, r](uint32_t t)
+            {
+                const size_t i0 = std::min(slice_size(t), r * scheduled_chunk_points);
+                const size_t i1 = std::min(slice_size(t), i0 + scheduled_chunk_points);
+                run(t, i0, i1);
+            }));
+        }
+    };
+
+    run_rounds([&](uint32_t t, size_t i0, size_t i1)
+    {
+        GridSlice& slice = slices[t];
+        const vec3* points = input + count * t / slice_count;
+
+        for (size_t i = i0; i < i1; i++)
+        {
+            slice.bucket_ids[i] = grid.Bucket(points[i]);
+            slice.histogram[slice.bucket_ids[i]]++;
+        }
+    });
+
+    std::vector<std::vector<uint32_t>> offsets = grid.Allocate(slices);
+
+    run_rounds([&](uint32_t t, size_t i0, size_t i1)
+    {
+        grid.ScatterRange(input, slices, t, i0, i1, offsets[t]);
+    });
+
+    return true;
+}
+
+bool ScheduledNearest(
+    Scheduler& scheduler,
+    const uint32_t tenant,
+    const GridView& grid,
+    const vec3* queries,
+    const size_t count,
+    Nearest* results,
+    const SearchOptions& options,
+    const Priority priority,
+    const CancelToken* cancel,
+    uint8_t* completed)
+{
+    const uint32_t chunks = chunk_count(count);
+    std::atomic<uint32_t> chunks_run(0);
+
+    if (completed)
+    {
+        std::fill(completed, completed + count, 0);
+    }
+
+    scheduler.Wait(scheduler.Submit(tenant, priority, chunks, [&](uint32_t c)
+    {
+        const size_t i0 = static_cast<size_t>(c) * scheduled_chunk_points;
+        const size_t i1 = std::min(count, i0 + scheduled_chunk_points);
+
+        for (size_t i = i0; i < i1; i++)
+        {
+            results[i] = grid.FindNearest(
+                queries[i],
+                std::numeric_limits<uint32_t>::max(),
+                options);
+        }
+
+        if (completed)
+        {
+            std::fill(completed + i0, completed + i1, 1);
+        }
+
+        chunks_run++;
+    },
+    cancel));
+
+    return chunks_run == chunks;
+}
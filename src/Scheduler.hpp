@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Grid.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+/* Scheduler */
+
+// One set of worker threads shared by many tenants, each typically serving
+// its own grids. Work is submitted as jobs of independent chunks and
+// workers run one chunk at a time, so a bulk job gives way to anything more
+// urgent between chunks rather than holding workers until it finishes.
+//
+// A free worker takes a chunk from the highest priority class with work.
+// Within a class tenants get chunks in proportion to their weight (stride
+// scheduling), and a tenant's jobs run in submission order.
+
+enum class Priority : uint32_t
+{
+    Interactive = 0,
+    Normal = 1,
+    Bulk = 2
+};
+
+const uint32_t priority_classes = 3;
+
+class Scheduler
+{
+public:
+    using ChunkJob = std::function<void(uint32_t chunk)>;
+
+    struct Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+private:
+    struct Tenant
+    {
+        uint32_t weight = 1;
+        // Chunks run divided by weight, lowest goes next.
+        double pass = 0.0;
+        std::deque<JobHandle> jobs[priority_classes];
+    };
+
+    std::vector<std::thread> threads_;
+    std::vector<Tenant> tenants_;
+
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable done_;
+    bool stopping_ = false;
+
+    void Loop();
+    void Drop(std::deque<JobHandle>& jobs);
+    bool Next(JobHandle& job, uint32_t& chunk);
+
+public:
+    Scheduler(const uint32_t threads = concurrent_threads());
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Returns the tenant id. A tenant of weight 2 gets twice the chunks of
+    // a tenant of weight 1 when both have work of the same priority.
+    uint32_t AddTenant(const uint32_t weight = 1);
+
+    // Queues 'chunks' calls of 'job', possibly concurrent and in any order.
+    // Once 'cancel' stops, chunks not yet started are dropped.
+    // Returns null for an unknown tenant, with nothing queued.
+    JobHandle Submit(
+        const uint32_t tenant,
+        const Priority priority,
+        const uint32_t chunks,
+        ChunkJob&& job,
+        const CancelToken* cancel = nullptr);
+
+    // Blocks until every chunk of 'job' has run or been dropped. Not for use
+    // inside a job. A null job is done.
+    void Wait(const JobHandle& job);
+
+    bool IsDone(const JobHandle& job);
+};
+
+// Points per chunk of the scheduled grid operations below.
+const uint32_t scheduled_chunk_points = 1 << 16;
+
+// Grid::Build as chunked jobs, hashing and scattering a chunk at a time
+// straight from 'input'. Build into a grid not being searched and swap it in
+// when done. Returns false, leaving the grid as it was, for an unknown
+// tenant.
+bool ScheduledBuild(
+    Scheduler& scheduler,
+    const uint32_t tenant,
+    Grid& grid,
+    const vec3* input,
+    const size_t count,
+    const Priority priority = Priority::Bulk);
+
+// Nearest indexed point of each query, see GridView::FindNearest. Returns
+// false if 'cancel' stopped it early or the tenant is unknown, 'completed'
+// then flags the queries with results.
+bool ScheduledNearest(
+    Scheduler& scheduler,
+    const uint32_t tenant,
+    const GridView& grid,
+    const vec3* queries,
+    const size_t count,
+    Nearest* results,
+    const SearchOptions& options = SearchOptions(),
+    const Priority priority = Priority::Interactive,
+    const CancelToken* cancel = nullptr,
+    uint8_t* completed = nullptr);
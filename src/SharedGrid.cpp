@@ -0,0 +1,166 @@
+#include "SharedGrid.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool PublishSharedGrid(const char*, const GridView&)
+{
+    return false;
+}
+
+bool UnlinkSharedGrid(const char*)
+{
+    return false;
+}
+
+SharedGrid::SharedGrid(const char*)
+{
+}
+
+SharedGrid::~SharedGrid()
+{
+}
+
+#else
+
+bool PublishSharedGrid(const char* name, const GridView& grid)
+{
+    const GridFileHeader header = MakeGridFileHeader(grid);
+    const size_t size = static_cast<size_t>(GridFileSize(header));
+
+    const int segment = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (segment < 0)
+    {
+        return false;
+    }
+
+    void* data = MAP_FAILED;
+
+    if (ftruncate(segment, static_cast<off_t>(size)) == 0)
+    {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment, 0);
+    }
+
+    close(segment);
+
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return false;
+    }
+
+    uint8_t* base = static_cast<uint8_t*>(data);
+
+    // Sections first, the header last. The segment starts zeroed, so a
+    // process attaching early sees no magic and fails rather than reading
+    // a partial grid.
+    std::memcpy(
+        base + header.buckets_offset,
+        grid.buckets_start,
+        (grid.bucket_count + 1) * sizeof(uint32_t));
+    std::memcpy(
+        base + header.positions_offset,
+        grid.positions,
+        grid.Size() * sizeof(vec3));
+    std::memcpy(
+        base + header.indices_offset,
+        grid.indices,
+        grid.Size() * sizeof(uint32_t));
+
+    GridFileHeader unpublished = header;
+    std::memset(unpublished.magic, 0, sizeof(unpublished.magic));
+    std::memcpy(base, &unpublished, sizeof(unpublished));
+
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(base, header.magic, sizeof(header.magic));
+
+    munmap(data, size);
+    return true;
+}
+
+bool UnlinkSharedGrid(const char* name)
+{
+    return shm_unlink(name) == 0;
+}
+
+SharedGrid::SharedGrid(const char* name)
+{
+    const int segment = shm_open(name, O_RDONLY, 0);
+
+    if (segment < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+    void* data = MAP_FAILED;
+
+    if (fstat(segment, &info) == 0 &&
+        static_cast<size_t>(info.st_size) >= sizeof(GridFileHeader))
+    {
+        data = mmap(
+            nullptr,
+            static_cast<size_t>(info.st_size),
+            PROT_READ,
+            MAP_SHARED,
+            segment,
+            0);
+    }
+
+    // The mapping keeps the segment alive.
+    close(segment);
+
+    if (data == MAP_FAILED)
+    {
+        return;
+    }
+
+    data_ = static_cast<const uint8_t*>(data);
+    size_ = static_cast<size_t>(info.st_size);
+
+    GridFileHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (!ValidGridFileHeader(header, size_) ||
+        !ValidGridBuckets(
+            reinterpret_cast<const uint32_t*>(data_ + header.buckets_offset),
+            header.bucket_count,
+            header.point_count))
+    {
+        return;
+    }
+
+    cell_size = header.cell_size;
+    bounds = vec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+    bucket_count = header.bucket_count;
+    bucket_shift = fib_calc_bucket_shift(bucket_count);
+    point_count = static_cast<size_t>(header.point_count);
+
+    buckets_start = reinterpret_cast<const uint32_t*>(
+        data_ + header.buckets_offset);
+    positions = reinterpret_cast<const vec3*>(
+        data_ + header.positions_offset);
+    indices = reinterpret_cast<const uint32_t*>(
+        data_ + header.indices_offset);
+}
+
+SharedGrid::~SharedGrid()
+{
+    if (data_)
+    {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "GridFile.hpp"
+
+/* Shared memory grid */
+
+// A built grid published once into a named shared memory segment and
+// queried read only by any number of processes. The segment holds the grid
+// file layout, whose sections are offsets from the segment start, so every
+// process can map it at any address. Attaching maps the segment without
+// reading or copying it.
+//
+// Names follow shm_open, a leading '/' and no other slashes. POSIX only,
+// elsewhere publishing and attaching fail.
+
+// Creates segment 'name' holding 'grid'. Fails if the name is taken, so a
+// stale segment has to be unlinked first. The segment outlives the process
+// until UnlinkSharedGrid.
+bool PublishSharedGrid(const char* name, const GridView& grid);
+
+// Removes the name, processes already attached keep their mapping.
+bool UnlinkSharedGrid(const char* name);
+
+class SharedGrid : public GridView
+{
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    SharedGrid(const char* name);
+    virtual ~SharedGrid();
+
+    SharedGrid(const SharedGrid&) = delete;
+    SharedGrid& operator=(const SharedGrid&) = delete;
+
+    bool IsOpen() const
+    {
+        return buckets_start != nullptr;
+    }
+};
@@ -0,0 +1,106 @@
+#include "TaskGraph.hpp"
+
+TaskGraph::TaskId TaskGraph::Add(std::function<void()>&& job)
+{
+    tasks_.emplace_back();
+    tasks_.back().job = std::move(job);
+    return static_cast<TaskId>(tasks_.size() - 1);
+}
+
+TaskGraph::TaskId TaskGraph::Add(
+    std::function<void()>&& job,
+    const std::vector<TaskId>& dependencies)
+{
+    const TaskId task = Add(std::move(job));
+    for (const TaskId dependency : dependencies)
+    {
+        Depend(task, dependency);
+    }
+    return task;
+}
+
+void TaskGraph::Depend(const TaskId task, const TaskId dependency)
+{
+    tasks_[dependency].dependents.push_back(task);
+    tasks_[task].dependencies++;
+}
+
+void TaskGraph::Run(const uint32_t threads)
+{
+    ready_.clear();
+    unfinished_ = tasks_.size();
+
+    for (TaskId id = 0; id < tasks_.size(); id++)
+    {
+        tasks_[id].remaining = tasks_[id].dependencies;
+        if (tasks_[id].remaining == 0)
+        {
+            ready_.push_back(id);
+        }
+    }
+
+    // Earliest added on top.
+    std::reverse(ready_.begin(), ready_.end());
+
+#ifdef CONCURRENT
+    WorkerPool workers;
+
+    for (uint32_t n = 0; n < std::max(threads, 1u); ++n)
+    {
+        workers.AddWorker(std::make_unique<Worker>([this]
+        {
+            Drain();
+        }));
+    }
+
+    workers.Resolve();
+#else
+    (void)threads;
+    Drain();
+#endif
+}
+
+void TaskGraph::Drain()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        condition_.wait(lock, [this]
+        {
+            return !ready_.empty() || unfinished_ == 0;
+        });
+
+        if (ready_.empty())
+        {
+            return;
+        }
+
+        const TaskId id = ready_.back();
+        ready_.pop_back();
+
+        lock.unlock();
+        tasks_[id].job();
+        lock.lock();
+
+        uint32_t released = 0;
+        for (const TaskId dependent : tasks_[id].dependents)
+        {
+            if (--tasks_[dependent].remaining == 0)
+            {
+                ready_.push_back(dependent);
+                released++;
+            }
+        }
+
+        if (--unfinished_ == 0)
+        {
+            condition_.notify_all();
+        }
+        else if (released > 1)
+        {
+            // This worker takes one of them itself.
+            condition_.notify_all();
+        }
+    }
+}
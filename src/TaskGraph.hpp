@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <deque>
+#include <vector>
+
+/* Task graph */
+
+// Jobs with dependencies, each run once every job it depends on has
+// finished. Workers take ready jobs from one queue, newest first, so a job
+// tends to run right after the one that produced its input while that is
+// still in cache. Meant for chunk sized jobs, the queue is locked.
+class TaskGraph
+{
+public:
+    using TaskId = uint32_t;
+
+private:
+    struct Task
+    {
+        std::function<void()> job;
+        std::vector<TaskId> dependents;
+        uint32_t dependencies = 0;
+        uint32_t remaining = 0;
+    };
+
+    std::deque<Task> tasks_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<TaskId> ready_;
+    size_t unfinished_ = 0;
+
+    void Drain();
+
+public:
+    TaskId Add(std::function<void()>&& job);
+    TaskId Add(std::function<void()>&& job, const std::vector<TaskId>& dependencies);
+
+    // 'task' waits for 'dependency' to finish.
+    void Depend(const TaskId task, const TaskId dependency);
+
+    size_t Size() const
+    {
+        return tasks_.size();
+    }
+
+    // Runs every job and returns when all have finished. The graph can be
+    // run again.
+    void Run(const uint32_t threads = concurrent_threads());
+};
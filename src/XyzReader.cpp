@@ -0,0 +1,272 @@
+#include "XyzReader.hpp"
+
+#include "MappedFile.hpp"
+
+#include <cstdio>
+
+/* Float parsing */
+
+static inline bool is_digit(const char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_delimiter(const char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+const double pow10_table[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline double scale_pow10(const double value, const int32_t exponent)
+{
+    if (exponent >= 0)
+    {
+        return exponent <= 22 ?
+            value * pow10_table[exponent] :
+            value * std::pow(10.0, exponent);
+    }
+
+    return exponent >= -22 ?
+        value / pow10_table[-exponent] :
+        value * std::pow(10.0, exponent);
+}
+
+// Locale independent [+-]digits[.digits][(e|E)[+-]digits]. Returns the end
+// of the number, or 'p' when there is none.
+static inline const char* parse_float(
+    const char* p,
+    const char* end,
+    float& value)
+{
+    const char* begin = p;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    // Digits past 19 cannot change a float.
+    uint64_t mantissa = 0;
+    int32_t exponent = 0;
+    bool digits = false;
+
+    for (; p < end && is_digit(*p); p++)
+    {
+        if (mantissa < 1000000000000000000ull)
+        {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        }
+        else
+        {
+            exponent++;
+        }
+        digits = true;
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && is_digit(*p); p++)
+        {
+            if (mantissa < 1000000000000000000ull)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                exponent--;
+            }
+            digits = true;
+        }
+    }
+
+    if (!digits)
+    {
+        return begin;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p + 1;
+        bool exponent_negative = false;
+        if (e < end && (*e == '-' || *e == '+'))
+        {
+            exponent_negative = *e == '-';
+            e++;
+        }
+
+        if (e < end && is_digit(*e))
+        {
+            int32_t e_value = 0;
+            for (; e < end && is_digit(*e); e++)
+            {
+                e_value = std::min(e_value * 10 + (*e - '0'), 9999);
+            }
+            exponent += exponent_negative ? -e_value : e_value;
+            p = e;
+        }
+    }
+
+    const double result = scale_pow10(static_cast<double>(mantissa), exponent);
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+/* Reader */
+
+static void ParseLines(
+    const char* p,
+    const char* end,
+    const GridView& grid,
+    const XyzOptions& options,
+    GridSlice& slice)
+{
+    const uint32_t last_column = std::max(
+        options.x_column,
+        std::max(options.y_column, options.z_column));
+
+    // Typical lines are a few dozen bytes.
+    const size_t estimate = static_cast<size_t>(end - p) / 24;
+    slice.positions.reserve(estimate);
+    slice.bucket_ids.reserve(estimate);
+    slice.histogram.assign(grid.bucket_count, 0);
+
+    while (p < end)
+    {
+        float fields[3];
+        uint32_t found = 0;
+        uint32_t column = 0;
+
+        while (p < end && *p != '\n' && column <= last_column)
+        {
+            while (p < end && is_delimiter(*p))
+            {
+                p++;
+            }
+
+            if (p == end || *p == '\n')
+            {
+                break;
+            }
+
+            float value = 0.0f;
+            const char* next = parse_float(p, end, value);
+
+            if (next != p && (next == end || is_delimiter(*next) || *next == '\n'))
+            {
+                if (column == options.x_column)
+                {
+                    fields[0] = value;
+                    found |= 1;
+                }
+                if (column == options.y_column)
+                {
+                    fields[1] = value;
+                    found |= 2;
+                }
+                if (column == options.z_column)
+                {
+                    fields[2] = value;
+                    found |= 4;
+                }
+                p = next;
+            }
+            else
+            {
+                // Not a number, skip the field.
+                while (p < end && !is_delimiter(*p) && *p != '\n')
+                {
+                    p++;
+                }
+            }
+
+            column++;
+        }
+
+        // Rest of the line.
+        while (p < end && *p != '\n')
+        {
+            p++;
+        }
+        p++;
+
+        if (found == 7)
+        {
+            const vec3 position = vec3(fields[0], fields[1], fields[2]);
+            const uint32_t bucket_id = grid.Bucket(position);
+            slice.positions.push_back(position);
+            slice.bucket_ids.push_back(bucket_id);
+            slice.histogram[bucket_id]++;
+        }
+    }
+}
+
+// Empty files have nothing to map, but are readable.
+static bool is_empty_file(const char* path)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    const bool empty = std::fgetc(file) == EOF && !std::ferror(file);
+    std::fclose(file);
+    return empty;
+}
+
+bool LoadXyz(const char* path, Grid& grid, const XyzOptions& options)
+{
+    MappedFile file(path);
+
+    if (!file.IsOpen())
+    {
+        if (is_empty_file(path))
+        {
+            grid.Build(std::vector<GridSlice>());
+            return true;
+        }
+        return false;
+    }
+
+    const char* data = reinterpret_cast<const char*>(file.Data());
+    const size_t size = file.Size();
+
+    // A few slices per worker for balance, each starting after a newline.
+    const size_t slice_count = std::max<size_t>(
+        1,
+        std::min<size_t>(concurrent_threads() * 4, size / 65536));
+
+    std::vector<size_t> bounds(slice_count + 1, size);
+    bounds[0] = 0;
+
+    for (size_t t = 1; t < slice_count; t++)
+    {
+        size_t b = std::max(bounds[t - 1], size * t / slice_count);
+        while (b < size && b > 0 && data[b - 1] != '\n')
+        {
+            b++;
+        }
+        bounds[t] = b;
+    }
+
+    std::vector<GridSlice> slices(slice_count);
+
+    ResolveConcurrent([&](uint32_t start, uint32_t step)
+    {
+        for (size_t t = start; t < slice_count; t += step)
+        {
+            ParseLines(
+                data + bounds[t],
+                data + bounds[t + 1],
+                grid,
+                options,
+                slices[t]);
+        }
+    });
+
+    grid.Build(slices);
+    return true;
+}
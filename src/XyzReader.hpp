@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Grid.hpp"
+
+/* ASCII XYZ / CSV reader */
+
+struct XyzOptions
+{
+    // Zero based columns, fields are split on spaces, tabs, commas and
+    // semicolons.
+    uint32_t x_column = 0;
+    uint32_t y_column = 1;
+    uint32_t z_column = 2;
+};
+
+// Memory maps 'path' and parses it on every worker, each taking a run of
+// whole lines and hashing its points into 'grid' buckets as it goes, then
+// builds 'grid' from those slices. Lines without numbers in all three
+// columns, such as headers and comments, are skipped. An empty file gives
+// an empty grid. Returns false when the file could not be read.
+bool LoadXyz(
+    const char* path,
+    Grid& grid,
+    const XyzOptions& options = XyzOptions());
@@ -0,0 +1,109 @@
+#include "Test.hpp"
+
+#include "ColumnFile.hpp"
+#include "Random.hpp"
+
+#include <cstddef>
+
+template <typename T>
+static bool loads_patched(const std::vector<uint8_t>& bytes, const size_t offset, const T value)
+{
+    const char* path = "ColumnFileTest.corrupt.nnpc";
+    test_write_patched(path, bytes, offset, value);
+
+    Grid grid(0.5f, 1 << 12, vec3(16.0f));
+    std::vector<std::vector<uint32_t>> attributes;
+    const bool loaded = LoadColumnFile(
+        path, grid, vec3(-std::numeric_limits<float>::max()),
+        vec3(std::numeric_limits<float>::max()), &attributes);
+    std::remove(path);
+    return loaded;
+}
+
+int main()
+{
+    const char* path = "ColumnFileTest.nnpc";
+    const size_t count = 5000;
+
+    std::vector<vec3> positions(count);
+    GenerateUniformPoints(positions.data(), count, 3, vec3(0.0f), vec3(10.0f));
+
+    // Attribute 0 names the input point, attribute 1 is a low entropy tag.
+    std::vector<std::vector<uint32_t>> attributes(2, std::vector<uint32_t>(count));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        attributes[0][i] = i;
+        attributes[1][i] = i / 100;
+    }
+
+    const vec3 region_min(2.0f, 3.0f, 1.0f);
+    const vec3 region_max(7.0f, 6.0f, 8.0f);
+    size_t inside = 0;
+    for (const vec3& p : positions)
+    {
+        inside += glm::all(glm::greaterThanEqual(p, region_min)) &&
+            glm::all(glm::lessThanEqual(p, region_max));
+    }
+
+    for (int compress = 0; compress < 2; compress++)
+    {
+        ColumnWriteOptions options;
+        options.chunk_points = 256;
+        options.compress = compress != 0;
+        CHECK(WriteColumnFile(path, positions.data(), count, attributes, options));
+
+        // Whole file, every point once with its attributes.
+        Grid grid(0.5f, 1 << 12, vec3(16.0f));
+        std::vector<std::vector<uint32_t>> loaded;
+        CHECK(LoadColumnFile(
+            path, grid, vec3(-std::numeric_limits<float>::max()),
+            vec3(std::numeric_limits<float>::max()), &loaded));
+        CHECK(grid.Size() == count);
+        CHECK(loaded.size() == 2);
+
+        std::vector<bool> seen(count, false);
+        for (size_t i = 0; i < grid.Size() && loaded.size() == 2; i++)
+        {
+            const uint32_t source = loaded[0][grid.indices[i]];
+            CHECK(source < count);
+            if (source < count)
+            {
+                CHECK(!seen[source]);
+                seen[source] = true;
+                CHECK(grid.positions[i] == positions[source]);
+                CHECK(loaded[1][grid.indices[i]] == source / 100);
+            }
+        }
+
+        // Region, exactly the points inside.
+        Grid region(0.5f, 1 << 12, vec3(16.0f));
+        std::vector<std::vector<uint32_t>> kept;
+        CHECK(LoadColumnFile(path, region, region_min, region_max, &kept));
+        CHECK(region.Size() == inside);
+        for (size_t i = 0; i < region.Size(); i++)
+        {
+            const uint32_t source = kept[0][region.indices[i]];
+            CHECK(source < count && region.positions[i] == positions[source]);
+        }
+    }
+
+    // Corrupt headers and directories are rejected rather than read.
+    const std::vector<uint8_t> bytes = test_read_file(path);
+    CHECK(bytes.size() > sizeof(ColumnFileHeader));
+
+    const size_t first_chunk = sizeof(ColumnFileHeader);
+    const size_t first_column = first_chunk + sizeof(ColumnChunk);
+
+    CHECK(loads_patched(bytes, 0, uint8_t('N')));
+    CHECK(!loads_patched(bytes, offsetof(ColumnFileHeader, attribute_count), uint32_t(0xffffffff)));
+    CHECK(!loads_patched(bytes, offsetof(ColumnFileHeader, attribute_count), uint32_t(0xfffffffd)));
+    CHECK(!loads_patched(bytes, offsetof(ColumnFileHeader, chunk_count), uint32_t(0x7fffffff)));
+    CHECK(!loads_patched(bytes, offsetof(ColumnFileHeader, point_count), uint64_t(count + 1)));
+    CHECK(!loads_patched(bytes, first_chunk + offsetof(ColumnChunk, point_count), uint32_t(0x40000000)));
+    CHECK(!loads_patched(bytes, first_column + offsetof(ColumnEntry, offset), uint64_t(0xfffffffffffffff0)));
+    CHECK(!loads_patched(bytes, first_column + offsetof(ColumnEntry, size), uint32_t(0xffffffff)));
+    CHECK(!loads_patched(bytes, first_column + offsetof(ColumnEntry, codec), uint32_t(7)));
+
+    std::remove(path);
+    return test_result();
+}
@@ -0,0 +1,143 @@
+#include "Test.hpp"
+
+#include "Geodetic.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <vector>
+
+static double haversine(const double lat0, const double lon0, const double lat1, const double lon1)
+{
+    const double to_radians = 3.14159265358979323846 / 180.0;
+    const double dlat = (lat1 - lat0) * to_radians;
+    const double dlon = (lon1 - lon0) * to_radians;
+    const double a =
+        std::sin(dlat / 2) * std::sin(dlat / 2) +
+        std::cos(lat0 * to_radians) * std::cos(lat1 * to_radians) *
+        std::sin(dlon / 2) * std::sin(dlon / 2);
+    return 2.0 * earth_radius * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+// Clusters around both poles and across the antimeridian, plus the exact
+// poles and meridian edges, where the unit sphere touches its bounds.
+static void generate(
+    const uint64_t seed,
+    const size_t count,
+    std::vector<double>& latitude,
+    std::vector<double>& longitude)
+{
+    latitude = { 90.0, -90.0, 0.0, 0.0, 0.0, 0.0 };
+    longitude = { 0.0, 180.0, 180.0, -180.0, 0.0, 90.0 };
+
+    for (size_t i = latitude.size(); i < count; i++)
+    {
+        const vec3 u = uniform_point(seed, i);
+
+        switch (i % 3)
+        {
+        case 0:
+            latitude.push_back(87.0 + 3.0 * u.x);
+            longitude.push_back(-180.0 + 360.0 * u.y);
+            break;
+        case 1:
+            latitude.push_back(-90.0 + 3.0 * u.x);
+            longitude.push_back(-180.0 + 360.0 * u.y);
+            break;
+        default:
+            latitude.push_back(-2.0 + 4.0 * u.x);
+            longitude.push_back(u.y < 0.5 ? 178.0 + 4.0 * u.z : -182.0 + 4.0 * u.z);
+            break;
+        }
+    }
+}
+
+int main()
+{
+    // Float unit vectors resolve to about a meter.
+    const double tolerance = 5.0;
+
+    std::vector<double> point_lat, point_lon, query_lat, query_lon;
+    generate(1, 4000, point_lat, point_lon);
+    generate(2, 1000, query_lat, query_lon);
+
+    std::vector<vec3> points(point_lat.size());
+    std::vector<vec3> queries(query_lat.size());
+    GeodeticToUnit(point_lat.data(), point_lon.data(), points.size(), points.data());
+    GeodeticToUnit(query_lat.data(), query_lon.data(), queries.size(), queries.data());
+
+    // Large enough that cells reach past the edge of the sphere.
+    for (const double max_distance : { 20000.0, 500000.0 })
+    {
+        Grid grid = GeodeticGrid(max_distance, points.size());
+        grid.Build(points.data(), points.size());
+
+        std::vector<uint32_t> nearest(queries.size());
+        std::vector<float> meters(queries.size());
+        GeodeticSearch(grid, queries.data(), queries.size(), nearest.data(), meters.data());
+
+        for (size_t q = 0; q < queries.size(); q++)
+        {
+            double best = std::numeric_limits<double>::max();
+            for (size_t p = 0; p < points.size(); p++)
+            {
+                best = std::min(best, haversine(
+                    query_lat[q], query_lon[q], point_lat[p], point_lon[p]));
+            }
+
+            if (best < max_distance - tolerance)
+            {
+                CHECK(nearest[q] != std::numeric_limits<uint32_t>::max());
+            }
+
+            if (nearest[q] != std::numeric_limits<uint32_t>::max())
+            {
+                const double found = haversine(
+                    query_lat[q], query_lon[q],
+                    point_lat[nearest[q]], point_lon[nearest[q]]);
+
+                CHECK(found <= best + tolerance);
+                CHECK(std::fabs(found - meters[q]) <= tolerance);
+                CHECK(found <= max_distance + tolerance);
+            }
+        }
+    }
+
+    // Join, every pair clearly inside is reported and none clearly outside.
+    const double join_distance = 30000.0;
+    JoinOptions options;
+    options.distance = static_cast<float>(join_distance);
+
+    std::vector<std::vector<uint32_t>> joined(query_lat.size());
+    GeodeticJoin(
+        query_lat.data(), query_lon.data(), query_lat.size(),
+        point_lat.data(), point_lon.data(), point_lat.size(),
+        options,
+        [&](const JoinPair* pairs, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const JoinPair& pair = pairs[i];
+                const double d = haversine(
+                    query_lat[pair.left], query_lon[pair.left],
+                    point_lat[pair.right], point_lon[pair.right]);
+
+                CHECK(d <= join_distance + tolerance);
+                CHECK(std::fabs(d - pair.distance) <= tolerance);
+                joined[pair.left].push_back(pair.right);
+            }
+        });
+
+    for (size_t q = 0; q < query_lat.size(); q++)
+    {
+        for (uint32_t p = 0; p < point_lat.size(); p++)
+        {
+            const double d = haversine(query_lat[q], query_lon[q], point_lat[p], point_lon[p]);
+            if (d < join_distance - tolerance)
+            {
+                CHECK(std::find(joined[q].begin(), joined[q].end(), p) != joined[q].end());
+            }
+        }
+    }
+
+    return test_result();
+}
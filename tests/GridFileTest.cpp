@@ -0,0 +1,99 @@
+#include "Test.hpp"
+
+#include "GridFile.hpp"
+#include "Random.hpp"
+
+#include <cstddef>
+
+template <typename T>
+static bool opens_patched(const std::vector<uint8_t>& bytes, const size_t offset, const T value)
+{
+    const char* path = "GridFileTest.corrupt.nngf";
+    test_write_patched(path, bytes, offset, value);
+
+    bool open;
+    {
+        GridFile file(path);
+        open = file.IsOpen();
+    }
+    std::remove(path);
+    return open;
+}
+
+int main()
+{
+    const char* path = "GridFileTest.nngf";
+    const size_t count = 20000;
+    const float radius = 0.25f;
+
+    std::vector<vec3> positions(count);
+    GenerateUniformPoints(positions.data(), count, 4, vec3(0.0f), vec3(10.0f));
+
+    Grid grid(radius * 2.0f, 1 << 12, vec3(16.0f));
+    grid.Build(positions.data(), count);
+    CHECK(WriteGridFile(path, grid));
+
+    {
+        GridFile file(path);
+        CHECK(file.IsOpen());
+        CHECK(file.Size() == count);
+        CHECK(file.bucket_count == grid.bucket_count);
+        CHECK(file.cell_size == grid.cell_size);
+        CHECK(file.bounds == grid.bounds);
+
+        if (file.IsOpen())
+        {
+            for (uint32_t b = 0; b <= grid.bucket_count; b++)
+            {
+                CHECK(file.buckets_start[b] == grid.buckets_start[b]);
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                CHECK(file.positions[i] == grid.positions[i]);
+                CHECK(file.indices[i] == grid.indices[i]);
+            }
+
+            // Queries answer exactly as on the grid the file came from.
+            std::vector<vec3> queries(1000);
+            GenerateUniformPoints(queries.data(), queries.size(), 5, vec3(0.0f), vec3(10.0f));
+            file.Prefetch(queries.data(), queries.size());
+
+            for (const vec3& q : queries)
+            {
+                const Nearest expected = grid.FindNearest(q, ~0u);
+                const Nearest found = file.FindNearest(q, ~0u);
+                CHECK(found.found == expected.found);
+                CHECK(found.index == expected.index);
+                CHECK(found.distance == expected.distance);
+            }
+
+            // Small, empty, huge and out of range boxes.
+            file.Prefetch(vec3(2.0f), vec3(2.5f));
+            file.Prefetch(vec3(3.0f), vec3(2.0f));
+            file.Prefetch(vec3(-1e30f), vec3(1e30f));
+            file.Prefetch(vec3(-1e30f), vec3(-1e29f));
+            file.Prefetch(vec3(-16.0f), vec3(-15.9f));
+        }
+    }
+
+    // Corrupt headers and directories are rejected rather than mapped.
+    const std::vector<uint8_t> bytes = test_read_file(path);
+    CHECK(bytes.size() > sizeof(GridFileHeader));
+
+    GridFileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const size_t directory = static_cast<size_t>(header.buckets_offset);
+
+    CHECK(opens_patched(bytes, 0, uint8_t('N')));
+    CHECK(!opens_patched(bytes, offsetof(GridFileHeader, bucket_count), uint32_t(1)));
+    CHECK(!opens_patched(bytes, offsetof(GridFileHeader, bucket_count), uint32_t(1u << 31)));
+    CHECK(!opens_patched(bytes, offsetof(GridFileHeader, point_count), uint64_t(1) << 62));
+    CHECK(!opens_patched(bytes, offsetof(GridFileHeader, point_count), uint64_t(count + 1)));
+    CHECK(!opens_patched(bytes, offsetof(GridFileHeader, buckets_offset), ~uint64_t(0)));
+    CHECK(!opens_patched(bytes, offsetof(GridFileHeader, indices_offset), ~uint64_t(0) - 7));
+    CHECK(!opens_patched(bytes, directory + 100 * sizeof(uint32_t), uint32_t(count)));
+    CHECK(!opens_patched(bytes, directory + grid.bucket_count * sizeof(uint32_t), uint32_t(count + 1)));
+
+    std::remove(path);
+    return test_result();
+}
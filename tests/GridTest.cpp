@@ -0,0 +1,92 @@
+#include "Test.hpp"
+
+#include "Grid.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+
+// BuildRadix orders points within a bucket by cell, Build keeps input order,
+// otherwise both must produce the same grid.
+template <typename Index>
+static void check_same_buckets(
+    const BasicGrid<Index>& expected,
+    const BasicGrid<Index>& grid,
+    const std::vector<vec3>& input)
+{
+    CHECK(grid.Size() == expected.Size());
+    if (grid.Size() != expected.Size())
+    {
+        return;
+    }
+
+    for (uint32_t b = 0; b <= expected.bucket_count; b++)
+    {
+        CHECK(grid.buckets_start[b] == expected.buckets_start[b]);
+    }
+
+    std::vector<Index> a;
+    std::vector<Index> b;
+
+    for (uint32_t bucket = 0; bucket < expected.bucket_count; bucket++)
+    {
+        const Index k0 = expected.buckets_start[bucket];
+        const Index k1 = expected.buckets_start[bucket + 1];
+
+        a.assign(expected.indices + k0, expected.indices + k1);
+        b.assign(grid.indices + k0, grid.indices + k1);
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        CHECK(a == b);
+
+        for (Index k = k0; k < k1; k++)
+        {
+            CHECK(grid.bucket_ids[k] == bucket);
+            CHECK(grid.positions[k] == input[grid.indices[k]]);
+        }
+    }
+}
+
+template <typename Index>
+static void check_builds(const std::vector<vec3>& input, const uint32_t bucket_count)
+{
+    BasicGrid<Index> expected(0.5f, bucket_count, vec3(16.0f));
+    expected.Build(input.data(), input.size());
+
+    // Fresh grids each time, so workers start from zeroed outputs.
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        BasicGrid<Index> grid(0.5f, bucket_count, vec3(16.0f));
+        grid.BuildRadix(input.data(), input.size());
+        check_same_buckets(expected, grid, input);
+    }
+}
+
+int main()
+{
+    // More workers than cores, so slices interleave.
+    concurrent_threads_limit() = 8;
+
+    const size_t count = 1 << 20;
+    std::vector<vec3> uniform(count);
+    GenerateUniformPoints(uniform.data(), count, 13, vec3(0.0f), vec3(10.0f));
+
+    // Few occupied cells, so most buckets are empty and slices end on
+    // long runs of them.
+    std::vector<vec3> clustered(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        clustered[i] = glm::floor(uniform[i] * 0.3f) + uniform[i] * 0.01f;
+    }
+
+    const std::vector<vec3> empty;
+    const std::vector<vec3> single(1, vec3(1.0f));
+    const std::vector<vec3>* inputs[] = { &uniform, &clustered, &empty, &single };
+
+    for (const std::vector<vec3>* input : inputs)
+    {
+        check_builds<uint32_t>(*input, 1 << 16);
+        check_builds<uint64_t>(*input, 1 << 12);
+    }
+
+    return test_result();
+}
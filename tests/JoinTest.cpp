@@ -0,0 +1,94 @@
+#include "Test.hpp"
+
+#include "Join.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+static bool pair_less(const JoinPair& a, const JoinPair& b)
+{
+    return std::tie(a.left, a.right) < std::tie(b.left, b.right);
+}
+
+int main()
+{
+    const size_t left_count = 3000;
+    const size_t right_count = 5000;
+    const float distance = 0.4f;
+
+    std::vector<vec3> left(left_count);
+    std::vector<vec3> right(right_count);
+    GenerateUniformPoints(left.data(), left_count, 1, vec3(0.0f), vec3(10.0f));
+    GenerateUniformPoints(right.data(), right_count, 2, vec3(0.0f), vec3(10.0f));
+
+    std::vector<JoinPair> expected;
+    for (uint32_t l = 0; l < left_count; l++)
+    {
+        for (uint32_t r = 0; r < right_count; r++)
+        {
+            const float d = glm::length(left[l] - right[r]);
+            if (d <= distance)
+            {
+                expected.push_back({ l, r, d });
+            }
+        }
+    }
+
+    JoinOptions options;
+    options.distance = distance;
+    options.bounds = vec3(16.0f);
+    options.chunk_size = 64;
+
+    // Built over either side.
+    for (int swap = 0; swap < 2; swap++)
+    {
+        std::vector<JoinPair> pairs;
+        const JoinResult result = swap ?
+            SpatialJoin(
+                right.data(), right_count, left.data(), left_count, options,
+                [&](const JoinPair* chunk, size_t count)
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        pairs.push_back({ chunk[i].right, chunk[i].left, chunk[i].distance });
+                    }
+                }) :
+            SpatialJoin(
+                left.data(), left_count, right.data(), right_count, options,
+                [&](const JoinPair* chunk, size_t count)
+                {
+                    pairs.insert(pairs.end(), chunk, chunk + count);
+                });
+
+        std::sort(pairs.begin(), pairs.end(), pair_less);
+
+        CHECK(!result.truncated);
+        CHECK(result.pairs == expected.size());
+        CHECK(pairs.size() == expected.size());
+
+        for (size_t i = 0; i < std::min(pairs.size(), expected.size()); i++)
+        {
+            CHECK(pairs[i].left == expected[i].left);
+            CHECK(pairs[i].right == expected[i].right);
+            CHECK(std::fabs(pairs[i].distance - expected[i].distance) < 1e-5f);
+        }
+    }
+
+    // Output limit.
+    options.max_pairs = expected.size() / 2;
+    size_t limited = 0;
+    const JoinResult result = SpatialJoin(
+        left.data(), left_count, right.data(), right_count, options,
+        [&](const JoinPair*, size_t count)
+        {
+            limited += count;
+        });
+
+    CHECK(result.truncated);
+    CHECK(limited == options.max_pairs);
+    CHECK(result.pairs == options.max_pairs);
+
+    return test_result();
+}
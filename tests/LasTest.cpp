@@ -0,0 +1,150 @@
+#include "Test.hpp"
+
+#include "LasReader.hpp"
+
+struct LasPoint
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+    uint8_t classification;
+};
+
+template <typename T>
+static void put(std::vector<uint8_t>& bytes, const size_t offset, const T value)
+{
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+}
+
+// A LAS file with no variable length records, point format 0 for 1.2 and
+// format 6 with only the 64 bit count for 1.4. Each point is return 1 of 1.
+static std::vector<uint8_t> las_file(
+    const uint8_t minor,
+    const std::vector<LasPoint>& points,
+    const glm::dvec3 scale,
+    const glm::dvec3 offset,
+    const glm::dvec3 min,
+    const glm::dvec3 max)
+{
+    const bool extended = minor >= 4;
+    const uint16_t header_size = extended ? 375 : 227;
+    const uint16_t record_length = extended ? 30 : 20;
+
+    std::vector<uint8_t> bytes(header_size + points.size() * record_length, 0);
+    std::memcpy(bytes.data(), "LASF", 4);
+    bytes[24] = 1;
+    bytes[25] = minor;
+    put(bytes, 94, header_size);
+    put(bytes, 96, uint32_t(header_size));
+    bytes[104] = extended ? 6 : 0;
+    put(bytes, 105, record_length);
+    put(bytes, 107, uint32_t(extended ? 0 : points.size()));
+
+    for (int a = 0; a < 3; a++)
+    {
+        put(bytes, 131 + a * 8, scale[a]);
+        put(bytes, 155 + a * 8, offset[a]);
+        put(bytes, 179 + a * 16, max[a]);
+        put(bytes, 187 + a * 16, min[a]);
+    }
+
+    if (extended)
+    {
+        put(bytes, 247, uint64_t(points.size()));
+    }
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const size_t record = header_size + i * record_length;
+        put(bytes, record, points[i].x);
+        put(bytes, record + 4, points[i].y);
+        put(bytes, record + 8, points[i].z);
+        bytes[record + 14] = extended ? 0x11 : 0x09;
+        bytes[record + (extended ? 16 : 15)] = points[i].classification;
+    }
+
+    return bytes;
+}
+
+static void write_bytes(const char* path, const std::vector<uint8_t>& bytes)
+{
+    test_write_patched(path, bytes, bytes.size(), uint8_t(0));
+}
+
+template <typename T>
+static bool loads_patched(const std::vector<uint8_t>& bytes, const size_t offset, const T value)
+{
+    const char* path = "LasTest.corrupt.las";
+    test_write_patched(path, bytes, offset, value);
+
+    Grid grid(1.0f, 1 << 8, vec3(4096.0f));
+    const bool loaded = LoadLas(path, grid);
+    std::remove(path);
+    return loaded;
+}
+
+int main()
+{
+    const char* path = "LasTest.las";
+
+    // Georeferenced coordinates, kept relative to the header minimum.
+    const glm::dvec3 scale(0.01, 0.01, 0.001);
+    const glm::dvec3 offset(500000.0, 4100000.0, 100.0);
+    const glm::dvec3 min(500010.0, 4100020.0, 100.5);
+    const glm::dvec3 max(500200.0, 4100300.0, 180.0);
+
+    std::vector<LasPoint> points;
+    for (int32_t i = 0; i < 1000; i++)
+    {
+        const uint8_t classification = i % 3 == 0 ? 7 : 2;
+        points.push_back({ 1000 + i * 17, 2000 + i * 23 % 20000, 500 + i * 71 % 70000, classification });
+    }
+
+    const uint8_t minors[] = { 2, 4 };
+    for (const uint8_t minor : minors)
+    {
+        const std::vector<uint8_t> bytes = las_file(minor, points, scale, offset, min, max);
+        write_bytes(path, bytes);
+
+        LasHeader header;
+        Grid grid(1.0f, 1 << 10, vec3(4096.0f));
+        CHECK(LoadLas(path, grid, LasOptions(), &header));
+        CHECK(header.version_minor == minor);
+        CHECK(header.point_format == (minor >= 4 ? 6 : 0));
+        CHECK(header.point_count == points.size());
+        CHECK(header.min == min);
+        CHECK(grid.Size() == points.size());
+
+        for (size_t k = 0; k < std::min(grid.Size(), points.size()); k++)
+        {
+            const LasPoint& p = points[grid.indices[k]];
+            const glm::dvec3 expected =
+                glm::dvec3(p.x, p.y, p.z) * scale + offset - min;
+            const glm::dvec3 error = glm::abs(glm::dvec3(grid.positions[k]) - expected);
+            CHECK(glm::all(glm::lessThan(error, glm::dvec3(1e-4))));
+        }
+
+        // Every third point is of another class.
+        LasOptions ground;
+        ground.classifications.reset();
+        ground.classifications.set(2);
+
+        Grid filtered(1.0f, 1 << 10, vec3(4096.0f));
+        CHECK(LoadLas(path, filtered, ground));
+        CHECK(filtered.Size() == 666);
+
+        // Cut short in the records, short of the header, with a record
+        // length below the format's, and with records placed inside the
+        // header or past the end.
+        CHECK(loads_patched(bytes, 0, uint8_t('L')));
+        CHECK(!loads_patched(std::vector<uint8_t>(bytes.begin(), bytes.end() - 1), 0, uint8_t('L')));
+        CHECK(!loads_patched(std::vector<uint8_t>(bytes.begin(), bytes.begin() + 200), 0, uint8_t('L')));
+        CHECK(!loads_patched(bytes, 105, uint16_t(minor >= 4 ? 29 : 19)));
+        CHECK(!loads_patched(bytes, 96, uint32_t(100)));
+        CHECK(!loads_patched(bytes, 96, uint32_t(bytes.size() + 1)));
+        CHECK(!loads_patched(bytes, 104, uint8_t(0x80)));
+    }
+
+    std::remove(path);
+    return test_result();
+}
@@ -0,0 +1,105 @@
+#include "Test.hpp"
+
+#include "Match.hpp"
+#include "Random.hpp"
+
+struct BruteNearest
+{
+    uint32_t index;
+    float first;
+    float second;
+};
+
+// Nearest and second nearest distances over all of 'to', index NONE when
+// the nearest is beyond 'distance'.
+static BruteNearest brute_nearest(const std::vector<vec3>& to, const vec3 p, const float distance)
+{
+    BruteNearest nearest = {
+        ~0u, std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+
+    for (uint32_t j = 0; j < to.size(); j++)
+    {
+        const float d = glm::length(to[j] - p);
+        if (d < nearest.first)
+        {
+            nearest.second = nearest.first;
+            nearest.first = d;
+            nearest.index = j;
+        }
+        else if (d < nearest.second)
+        {
+            nearest.second = d;
+        }
+    }
+
+    if (nearest.first > distance)
+    {
+        nearest.index = ~0u;
+    }
+    return nearest;
+}
+
+int main()
+{
+    const size_t left_count = 3000;
+    const size_t right_count = 2500;
+    const float distance = 0.5f;
+
+    std::vector<vec3> left(left_count);
+    std::vector<vec3> right(right_count);
+    GenerateUniformPoints(left.data(), left_count, 1, vec3(0.0f), vec3(12.0f));
+    GenerateUniformPoints(right.data(), right_count, 2, vec3(0.0f), vec3(12.0f));
+
+    std::vector<BruteNearest> from_left(left_count);
+    std::vector<BruteNearest> from_right(right_count);
+    for (size_t i = 0; i < left_count; i++)
+    {
+        from_left[i] = brute_nearest(right, left[i], distance);
+    }
+    for (size_t i = 0; i < right_count; i++)
+    {
+        from_right[i] = brute_nearest(left, right[i], distance);
+    }
+
+    const float ratios[] = { 1.0f, 0.8f, 0.5f };
+
+    for (const float ratio : ratios)
+    {
+        MatchOptions options;
+        options.distance = distance;
+        options.bounds = vec3(32.0f);
+        options.ratio = ratio;
+
+        const std::vector<MatchPair> pairs = MutualNearest(
+            left.data(), left_count, right.data(), right_count, options);
+
+        // A second neighbour beyond the distance counts as at the distance.
+        const auto passes = [&](const BruteNearest& nearest)
+        {
+            return nearest.first <= ratio * std::min(nearest.second, distance);
+        };
+
+        std::vector<MatchPair> expected;
+        for (uint32_t i = 0; i < left_count; i++)
+        {
+            const BruteNearest& l = from_left[i];
+            if (l.index != ~0u && passes(l) &&
+                from_right[l.index].index == i && passes(from_right[l.index]))
+            {
+                expected.push_back({ i, l.index, l.first });
+            }
+        }
+
+        CHECK(!expected.empty());
+        CHECK(pairs.size() == expected.size());
+
+        for (size_t k = 0; k < std::min(pairs.size(), expected.size()); k++)
+        {
+            CHECK(pairs[k].left == expected[k].left);
+            CHECK(pairs[k].right == expected[k].right);
+            CHECK(std::fabs(pairs[k].distance - expected[k].distance) < 1e-5f);
+        }
+    }
+
+    return test_result();
+}
@@ -0,0 +1,199 @@
+#include "Test.hpp"
+
+#include "NNSearch.h"
+#include "Random.hpp"
+
+#include <vector>
+
+// Only the C API is used, through the shared library as embedders do.
+
+struct Record
+{
+    float x, y, z;
+    uint32_t tag;
+};
+
+static nn_positions record_positions(const std::vector<Record>& records)
+{
+    nn_positions positions;
+    positions.x = &records[0].x;
+    positions.y = &records[0].y;
+    positions.z = &records[0].z;
+    positions.stride = sizeof(Record);
+    return positions;
+}
+
+static vec3 record_position(const Record& record)
+{
+    return vec3(record.x, record.y, record.z);
+}
+
+// Nearest point other than 'exclude' within 'radius', or NN_NONE.
+static uint32_t brute_nearest(
+    const std::vector<Record>& points,
+    const vec3 query,
+    const float radius,
+    const uint32_t exclude,
+    float& distance)
+{
+    uint32_t nearest = NN_NONE;
+    distance = std::numeric_limits<float>::max();
+
+    for (uint32_t i = 0; i < points.size(); i++)
+    {
+        const float d = glm::length(record_position(points[i]) - query);
+        if (i != exclude && d <= radius && d < distance)
+        {
+            nearest = i;
+            distance = d;
+        }
+    }
+    return nearest;
+}
+
+int main()
+{
+    const size_t count = 5000;
+    const size_t query_count = 2000;
+    const float radius = 0.3f;
+
+    // Interleaved records for the points, separate arrays for the queries.
+    std::vector<Record> points(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const vec3 p = uniform_point(8, i) * 10.0f;
+        points[i] = { p.x, p.y, p.z, static_cast<uint32_t>(i) };
+    }
+
+    std::vector<float> qx(query_count), qy(query_count), qz(query_count);
+    for (size_t i = 0; i < query_count; i++)
+    {
+        const vec3 q = uniform_point(9, i) * 10.0f;
+        qx[i] = q.x;
+        qy[i] = q.y;
+        qz[i] = q.z;
+    }
+
+    const nn_positions queries = { qx.data(), qy.data(), qz.data(), sizeof(float) };
+
+    std::vector<uint32_t> expected_nearest(query_count);
+    std::vector<float> expected_distances(query_count);
+    for (size_t i = 0; i < query_count; i++)
+    {
+        expected_nearest[i] = brute_nearest(
+            points, vec3(qx[i], qy[i], qz[i]), radius, NN_NONE, expected_distances[i]);
+    }
+
+    std::vector<uint32_t> expected_self(count);
+    std::vector<float> expected_self_distances(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        expected_self[i] = brute_nearest(
+            points, record_position(points[i]), radius, i, expected_self_distances[i]);
+    }
+
+    // Invalid bucket counts, a shift of 32 for one bucket.
+    {
+        const nn_positions positions = record_positions(points);
+        nn_index_options options;
+        nn_index_options_init(&options);
+        options.radius = radius;
+
+        nn_index* index = nullptr;
+        options.bucket_count = 1;
+        CHECK(nn_index_create(&positions, count, &options, &index) == NN_INVALID_ARGUMENT);
+        options.bucket_count = 3;
+        CHECK(nn_index_create(&positions, count, &options, &index) == NN_INVALID_ARGUMENT);
+        options.radius = 0.0f;
+        options.bucket_count = 0;
+        CHECK(nn_index_create(&positions, count, &options, &index) == NN_INVALID_ARGUMENT);
+        CHECK(index == nullptr);
+    }
+
+    // Sized from the count, and two buckets where most points share one
+    // and the grid turns up neighbours far beyond the radius.
+    const uint32_t bucket_counts[] = { 0, 2 };
+
+    for (const uint32_t bucket_count : bucket_counts)
+    {
+        std::vector<Record> copy = points;
+        const nn_positions positions = record_positions(copy);
+
+        nn_index_options options;
+        nn_index_options_init(&options);
+        options.radius = radius;
+        options.bounds[0] = options.bounds[1] = options.bounds[2] = 16.0f;
+        options.bucket_count = bucket_count;
+
+        nn_index* index = nullptr;
+        CHECK(nn_index_create(&positions, count, &options, &index) == NN_OK);
+        if (!index)
+        {
+            continue;
+        }
+        CHECK(nn_index_size(index) == count);
+
+        // The index holds its own copy of the positions.
+        std::fill(copy.begin(), copy.end(), Record{ -1.0f, -1.0f, -1.0f, 0 });
+
+        nn_search_options search;
+        nn_search_options_init(&search);
+
+        std::vector<uint32_t> nearest(query_count);
+        std::vector<float> distances(query_count);
+        CHECK(nn_search_nearest(
+            index, &queries, query_count, &search,
+            nearest.data(), distances.data()) == NN_OK);
+
+        for (size_t i = 0; i < query_count; i++)
+        {
+            CHECK(nearest[i] == expected_nearest[i]);
+            CHECK(std::fabs(distances[i] - expected_distances[i]) < 1e-5f ||
+                distances[i] == expected_distances[i]);
+        }
+
+        std::vector<uint32_t> self(count);
+        std::vector<float> self_distances(count);
+        CHECK(nn_search_self(index, &search, self.data(), self_distances.data()) == NN_OK);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            CHECK(self[i] == expected_self[i]);
+            CHECK(std::fabs(self_distances[i] - expected_self_distances[i]) < 1e-5f ||
+                self_distances[i] == expected_self_distances[i]);
+        }
+
+        const float within = 0.2f;
+        std::vector<uint8_t> hits(query_count);
+        CHECK(nn_search_any_within(index, &queries, query_count, within, hits.data()) == NN_OK);
+        CHECK(nn_search_any_within(
+            index, &queries, query_count, radius * 2.0f, hits.data()) == NN_INVALID_ARGUMENT);
+
+        for (size_t i = 0; i < query_count; i++)
+        {
+            float distance;
+            const bool hit = brute_nearest(
+                points, vec3(qx[i], qy[i], qz[i]), within, NN_NONE, distance) != NN_NONE;
+            CHECK((hits[i] != 0) == hit);
+        }
+
+        // Cancelled before it starts, nothing is marked completed.
+        nn_cancel* cancel = nullptr;
+        CHECK(nn_cancel_create(&cancel) == NN_OK);
+        nn_cancel_request(cancel);
+
+        std::vector<uint8_t> completed(query_count, 1);
+        search.cancel = cancel;
+        search.completed = completed.data();
+        CHECK(nn_search_nearest(
+            index, &queries, query_count, &search,
+            nearest.data(), nullptr) == NN_CANCELLED);
+        CHECK(std::count(completed.begin(), completed.end(), 0) ==
+            static_cast<std::ptrdiff_t>(query_count));
+
+        nn_cancel_destroy(cancel);
+        nn_index_destroy(index);
+    }
+
+    return test_result();
+}
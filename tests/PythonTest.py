@@ -0,0 +1,138 @@
+# Brute force checks of the nnsearch module, run by ctest with the build
+# directory on PYTHONPATH. Uses only the standard library, so points are
+# array('f') buffers viewed as (n, 3).
+
+import array
+import math
+import random
+import sys
+import threading
+
+import nnsearch
+
+failures = 0
+
+
+def check(condition, message):
+    global failures
+    if not condition:
+        print("FAILED: " + message, file=sys.stderr)
+        failures += 1
+
+
+def points_buffer(points):
+    flat = array.array("f", [c for p in points for c in p])
+    return memoryview(flat).cast("B").cast("f", [len(points), 3])
+
+
+def as_float32(value):
+    return array.array("f", [value])[0]
+
+
+def brute_nearest(points, query, radius, exclude=None):
+    nearest = nnsearch.NONE
+    distance = float("inf")
+    for i, p in enumerate(points):
+        d = math.dist(p, query)
+        if i != exclude and d <= radius and d < distance:
+            nearest = i
+            distance = d
+    return nearest, distance
+
+
+def main():
+    rng = random.Random(10)
+    radius = 0.3
+
+    # Rounded through float32 so the brute force sees what the index sees.
+    def point():
+        return tuple(as_float32(rng.uniform(0.0, 5.0)) for _ in range(3))
+
+    points = [point() for _ in range(1500)]
+    queries = [point() for _ in range(300)]
+
+    index = nnsearch.Index(points_buffer(points), radius, (8.0, 8.0, 8.0))
+    check(len(index) == len(points), "len(index)")
+
+    indices, distances = index.nearest(points_buffer(queries))
+    indices = memoryview(indices).tolist()
+    distances = memoryview(distances).tolist()
+
+    for q, query in enumerate(queries):
+        expected, distance = brute_nearest(points, query, radius)
+        check(indices[q] == expected, "nearest of query %d" % q)
+        if expected != nnsearch.NONE:
+            check(abs(distances[q] - distance) < 1e-5, "distance of query %d" % q)
+
+    indices, distances = index.self_nearest()
+    indices = memoryview(indices).tolist()
+
+    for i, p in enumerate(points):
+        expected, _ = brute_nearest(points, p, radius, exclude=i)
+        check(indices[i] == expected, "self nearest of point %d" % i)
+
+    hits = memoryview(index.any_within(points_buffer(queries), 0.2)).tolist()
+    for q, query in enumerate(queries):
+        expected, _ = brute_nearest(points, query, 0.2)
+        check(bool(hits[q]) == (expected != nnsearch.NONE), "any within of query %d" % q)
+
+    # Timeouts, a zero one stops before any query is searched.
+    indices, _ = index.nearest(points_buffer(queries), timeout=60.0)
+    check(memoryview(indices).tolist()[0] == brute_nearest(points, queries[0], radius)[0],
+          "nearest with a timeout")
+    for call in (lambda: index.nearest(points_buffer(queries), timeout=0),
+                 lambda: index.self_nearest(timeout=0.0)):
+        try:
+            call()
+            check(False, "zero timeout did not raise")
+        except TimeoutError:
+            pass
+    try:
+        index.self_nearest(timeout=-1.0)
+        check(False, "negative timeout accepted")
+    except ValueError:
+        pass
+
+    # Bad input.
+    try:
+        index.nearest(memoryview(array.array("f", [0.0] * 4)).cast("B").cast("f", [2, 2]))
+        check(False, "(n, 2) queries accepted")
+    except ValueError:
+        pass
+
+    # Re-initializing would free the index under searches running without
+    # the GIL, it is refused and the index keeps answering.
+    stop = threading.Event()
+    results = []
+
+    def search():
+        while True:
+            found, _ = index.nearest(points_buffer(queries[:50]))
+            results.append(memoryview(found).tolist())
+            if stop.is_set():
+                return
+
+    searcher = threading.Thread(target=search)
+    searcher.start()
+
+    for _ in range(20):
+        try:
+            index.__init__(points_buffer(points[:10]), radius)
+            check(False, "re-init accepted")
+        except RuntimeError:
+            pass
+
+    stop.set()
+    searcher.join()
+
+    check(len(index) == len(points), "len(index) after re-init")
+    check(all(r == results[0] for r in results), "searches during re-init")
+
+    if failures:
+        print("%d checks failed" % failures, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,141 @@
+#include "Test.hpp"
+
+#include "QuantizedFile.hpp"
+#include "Random.hpp"
+
+#include <cstddef>
+
+template <typename T>
+static bool loads_patched(const std::vector<uint8_t>& bytes, const size_t offset, const T value)
+{
+    const char* path = "QuantizedFileTest.corrupt.nnqc";
+    test_write_patched(path, bytes, offset, value);
+
+    Grid grid;
+    const bool loaded = LoadQuantizedFile(path, grid);
+    std::remove(path);
+    return loaded;
+}
+
+int main()
+{
+    const char* path = "QuantizedFileTest.nnqc";
+    const size_t count = 30000;
+    const double precision = 0.001;
+
+    std::vector<vec3> positions(count);
+    GenerateUniformPoints(positions.data(), count, 7, vec3(0.0f), vec3(10.0f));
+
+    Grid grid(0.5f, 1 << 12, vec3(16.0f));
+    grid.Build(positions.data(), count);
+
+    for (int store_indices = 0; store_indices < 2; store_indices++)
+    {
+        QuantizeOptions options;
+        options.precision = precision;
+        options.block_points = 4096;
+        options.store_indices = store_indices != 0;
+        CHECK(WriteQuantizedFile(path, grid, options));
+
+        Grid loaded;
+        CHECK(LoadQuantizedFile(path, loaded));
+        CHECK(loaded.Size() == count);
+        CHECK(loaded.bucket_count == grid.bucket_count);
+        CHECK(loaded.cell_size == grid.cell_size);
+
+        // Every point within half a step per axis of its source. Without
+        // stored indices the source is whichever point is nearest.
+        const float tolerance = static_cast<float>(precision * 0.5) + 1e-5f;
+        std::vector<bool> seen(count, false);
+        for (size_t k = 0; k < loaded.Size(); k++)
+        {
+            const uint32_t i = loaded.indices[k];
+            CHECK(i < count && !seen[i]);
+            if (i < count)
+            {
+                seen[i] = true;
+                const vec3 source = store_indices ?
+                    positions[i] :
+                    grid.positions[grid.FindNearest(loaded.positions[k], ~0u).index];
+                const vec3 error = glm::abs(loaded.positions[k] - source);
+                CHECK(glm::all(glm::lessThanEqual(error, vec3(tolerance))));
+                CHECK(loaded.Bucket(loaded.positions[k]) == loaded.bucket_ids[k]);
+            }
+        }
+
+        for (uint32_t b = 0; b < loaded.bucket_count; b++)
+        {
+            CHECK(loaded.buckets_start[b] <= loaded.buckets_start[b + 1]);
+        }
+    }
+
+    // Zero points per block means a block per occupied bucket.
+    {
+        const char* tiny_path = "QuantizedFileTest.tiny.nnqc";
+        Grid small(0.5f, 1 << 6, vec3(16.0f));
+        small.Build(positions.data(), 500);
+
+        QuantizeOptions options;
+        options.block_points = 0;
+        CHECK(WriteQuantizedFile(tiny_path, small, options));
+
+        QuantizedFileHeader tiny;
+        const std::vector<uint8_t> tiny_bytes = test_read_file(tiny_path);
+        CHECK(tiny_bytes.size() > sizeof(tiny));
+        std::memcpy(&tiny, tiny_bytes.data(), std::min(tiny_bytes.size(), sizeof(tiny)));
+        CHECK(tiny.block_count > 1);
+
+        Grid loaded;
+        CHECK(LoadQuantizedFile(tiny_path, loaded));
+        CHECK(loaded.Size() == 500);
+        std::remove(tiny_path);
+    }
+
+    // Corrupt headers, directories and streams are rejected rather than
+    // decoded.
+    const std::vector<uint8_t> bytes = test_read_file(path);
+    CHECK(bytes.size() > sizeof(QuantizedFileHeader));
+
+    QuantizedFileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    const size_t directory = sizeof(QuantizedFileHeader);
+    const size_t second = directory + sizeof(QuantizedBlock);
+    CHECK(header.block_count > 1);
+
+    CHECK(loads_patched(bytes, 0, uint8_t('N')));
+    CHECK(!loads_patched(bytes, offsetof(QuantizedFileHeader, bucket_count), uint32_t(1)));
+    CHECK(!loads_patched(bytes, offsetof(QuantizedFileHeader, block_count), uint32_t(0)));
+    CHECK(!loads_patched(bytes, offsetof(QuantizedFileHeader, block_count), uint32_t(0xffffffff)));
+    CHECK(!loads_patched(bytes, offsetof(QuantizedFileHeader, point_count), uint64_t(count + 1)));
+    CHECK(!loads_patched(bytes, offsetof(QuantizedFileHeader, precision), 0.0));
+    CHECK(!loads_patched(bytes, directory + offsetof(QuantizedBlock, first_bucket), uint32_t(1)));
+    CHECK(!loads_patched(bytes, directory + offsetof(QuantizedBlock, point_count), uint32_t(0xfffffff0)));
+    CHECK(!loads_patched(bytes, directory + offsetof(QuantizedBlock, offset), ~uint64_t(0) - 15));
+    CHECK(!loads_patched(bytes, directory + offsetof(QuantizedBlock, size), uint32_t(0xffffffff)));
+    CHECK(!loads_patched(bytes, directory + offsetof(QuantizedBlock, raw_size), uint32_t(0xffffffff)));
+    CHECK(!loads_patched(bytes, second + offsetof(QuantizedBlock, first_bucket), uint32_t(0)));
+    CHECK(!loads_patched(bytes, second + offsetof(QuantizedBlock, point_start), uint32_t(0)));
+
+    // A rANS state outside the encoder's range, and a block claiming more
+    // bytes than its stream holds.
+    size_t rans_blocks = 0;
+    for (uint32_t n = 0; n < header.block_count; n++)
+    {
+        QuantizedBlock block;
+        std::memcpy(&block, &bytes[directory + n * sizeof(QuantizedBlock)], sizeof(block));
+        if (block.codec == QUANTIZED_RANS)
+        {
+            const size_t entry = directory + n * sizeof(QuantizedBlock);
+            const size_t state = static_cast<size_t>(block.offset) + 256 * sizeof(uint16_t);
+            CHECK(!loads_patched(bytes, state, uint32_t(0)));
+            CHECK(!loads_patched(bytes, state, uint32_t(0xffffffff)));
+            CHECK(!loads_patched(bytes, entry + offsetof(QuantizedBlock, raw_size), block.raw_size + 1));
+            rans_blocks++;
+        }
+    }
+    CHECK(rans_blocks > 0);
+
+    std::remove(path);
+    return test_result();
+}
@@ -0,0 +1,100 @@
+#include "Test.hpp"
+
+#include "ResultWriter.hpp"
+#include "Random.hpp"
+
+#include <clocale>
+#include <string>
+
+static std::vector<std::string> read_lines(const char* path)
+{
+    const std::vector<uint8_t> bytes = test_read_file(path);
+    std::vector<std::string> lines(1);
+    for (const uint8_t c : bytes)
+    {
+        if (c == '\n')
+        {
+            lines.emplace_back();
+        }
+        else
+        {
+            lines.back() += static_cast<char>(c);
+        }
+    }
+    lines.pop_back();
+    return lines;
+}
+
+int main()
+{
+    const char* path = "ResultWriterTest.csv";
+
+    // Fixed point values, then ones too large for three fixed decimals which
+    // go to scientific notation.
+    std::vector<float> distances = {
+        0.0f, 1.5f, -2.25f, 0.0004f, 123456.789f, 1e9f,
+        std::numeric_limits<float>::max(),
+        -std::numeric_limits<float>::max(),
+        1e16f, 1e18f, 9.99999999e20f, 2e16f,
+        std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN()
+    };
+    const size_t fixed_count = 6;
+
+    for (int i = 0; i < 2000; i++)
+    {
+        const float mantissa = 1.0f + 9.0f * uniform_point(6, i).x;
+        const float exponent = static_cast<float>(15 + i % 23);
+        const float sign = i % 2 ? -1.0f : 1.0f;
+        distances.push_back(sign * mantissa * std::pow(10.0f, exponent));
+    }
+
+    ResultColumns columns;
+    columns.count = distances.size();
+    columns.distances = distances.data();
+
+    ResultWriteOptions options;
+    options.decimals = 3;
+    options.chunk_rows = 100;
+    CHECK(WriteResultsCsv(path, columns, options));
+
+    const std::vector<std::string> lines = read_lines(path);
+    CHECK(lines.size() == distances.size() + 1);
+
+    const char* fixed[] = { "0.000", "1.500", "-2.250", "0.000", "123456.789", "1000000000.000" };
+    for (size_t i = 0; i < fixed_count && i + 1 < lines.size(); i++)
+    {
+        CHECK(lines[i + 1] == fixed[i]);
+    }
+
+    // The rest match printf in the C locale, which the test runs in.
+    for (size_t i = fixed_count; i + 1 < lines.size(); i++)
+    {
+        char expected[32];
+        std::snprintf(expected, sizeof(expected), "%.9g", distances[i]);
+        if (lines[i + 1] != expected)
+        {
+            std::fprintf(stderr, "%s != %s\n", lines[i + 1].c_str(), expected);
+        }
+        CHECK(lines[i + 1] == expected);
+    }
+
+    // A locale with a decimal comma changes nothing, where one is installed.
+    const char* comma_locales[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8" };
+    for (const char* locale : comma_locales)
+    {
+        if (std::setlocale(LC_NUMERIC, locale))
+        {
+            const char* localized_path = "ResultWriterTest.locale.csv";
+            CHECK(WriteResultsCsv(localized_path, columns, options));
+            CHECK(read_lines(localized_path) == lines);
+            std::remove(localized_path);
+            std::setlocale(LC_NUMERIC, "C");
+            break;
+        }
+    }
+
+    std::remove(path);
+    return test_result();
+}
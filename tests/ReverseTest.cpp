@@ -0,0 +1,76 @@
+#include "Test.hpp"
+
+#include "Random.hpp"
+#include "Reverse.hpp"
+
+#include <algorithm>
+
+int main()
+{
+    const size_t count = 5000;
+    const size_t query_count = 1000;
+    const float cell_size = 1.0f;
+
+    std::vector<vec3> points(count);
+    std::vector<vec3> queries(query_count);
+    GenerateUniformPoints(points.data(), count, 9, vec3(0.0f), vec3(12.0f));
+    GenerateUniformPoints(queries.data(), query_count, 10, vec3(0.0f), vec3(12.0f));
+
+    Grid grid(cell_size, fib_calc_bucket_count(count), vec3(32.0f));
+    grid.Build(points.data(), count);
+
+    std::vector<float> nearest(count, std::numeric_limits<float>::max());
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t j = 0; j < count; j++)
+        {
+            if (i != j)
+            {
+                nearest[i] = std::min(nearest[i], glm::length(points[i] - points[j]));
+            }
+        }
+    }
+
+    // Spheres from the grid's own self search and from given distances.
+    const InfluenceSpheres searched = BuildInfluenceSpheres(grid);
+    const InfluenceSpheres given = BuildInfluenceSpheres(grid, nearest.data());
+    CHECK(searched.radii2 == given.radii2);
+    CHECK(searched.bucket_radii2 == given.bucket_radii2);
+
+    const ReverseNearestResult result = ReverseNearest(grid, searched, queries.data(), query_count);
+    CHECK(result.offsets.size() == query_count + 1);
+    if (result.offsets.size() != query_count + 1)
+    {
+        return test_result();
+    }
+
+    // Points whose nearest neighbour, within half a cell, is no nearer
+    // than the query.
+    size_t matches = 0;
+    for (size_t q = 0; q < query_count; q++)
+    {
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const float d = glm::length(points[i] - queries[q]);
+            const float radius = std::min(nearest[i], cell_size * 0.5f);
+            if (d * d <= radius * radius)
+            {
+                expected.push_back(i);
+            }
+        }
+
+        std::vector<uint32_t> found(
+            result.points.begin() + result.offsets[q],
+            result.points.begin() + result.offsets[q + 1]);
+        std::sort(found.begin(), found.end());
+
+        CHECK(found == expected);
+        matches += expected.size();
+    }
+
+    CHECK(matches > 0);
+    CHECK(result.points.size() == matches);
+
+    return test_result();
+}
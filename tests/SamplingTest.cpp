@@ -0,0 +1,89 @@
+#include "Test.hpp"
+
+#include "Random.hpp"
+#include "Sampling.hpp"
+
+#include <algorithm>
+
+// Whether every pick after 'first' is at the largest distance any point has
+// from the picks before it. Ties may be broken either way, so this rather
+// than comparing indices with a brute force sampling.
+static bool farthest_picks(
+    const std::vector<vec3>& points,
+    const std::vector<uint32_t>& picks,
+    const uint32_t first)
+{
+    std::vector<float> distances2(points.size(), std::numeric_limits<float>::max());
+
+    for (size_t s = 0; s < picks.size(); s++)
+    {
+        const uint32_t pick = picks[s];
+        if (pick >= points.size())
+        {
+            return false;
+        }
+
+        const float farthest = *std::max_element(distances2.begin(), distances2.end());
+        if (s == 0 ? pick != first : distances2[pick] != farthest)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const vec3 v = points[i] - points[pick];
+            distances2[i] = std::min(distances2[i], glm::dot(v, v));
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    const size_t count = 20000;
+    std::vector<vec3> points(count);
+    GenerateUniformPoints(points.data(), count, 4, vec3(-5.0f), vec3(30.0f));
+
+    const std::vector<uint32_t> uniform = FarthestPointSampling(points.data(), count, 1000, 17);
+    CHECK(uniform.size() == 1000);
+    CHECK(farthest_picks(points, uniform, 17));
+
+    // A plane with duplicated points.
+    for (size_t i = 0; i < count; i++)
+    {
+        points[i].z = 1.0f;
+    }
+    for (size_t i = 0; i < 1000; i++)
+    {
+        points[count - 1 - i] = points[i];
+    }
+
+    const std::vector<uint32_t> planar = FarthestPointSampling(points.data(), count, 1500, 0);
+    CHECK(planar.size() == 1500);
+    CHECK(farthest_picks(points, planar, 0));
+
+    // Asking for more samples than points picks each point once.
+    std::vector<vec3> line(300, vec3(1.0f));
+    for (int i = 0; i < 100; i++)
+    {
+        line[i] = vec3(i * 0.1f, 0.0f, 0.0f);
+    }
+
+    const std::vector<uint32_t> all = FarthestPointSampling(line.data(), line.size(), 400, 0);
+    CHECK(all.size() == line.size());
+
+    std::vector<bool> seen(line.size(), false);
+    for (const uint32_t i : all)
+    {
+        CHECK(i < line.size() && !seen[i]);
+        if (i < line.size())
+        {
+            seen[i] = true;
+        }
+    }
+
+    CHECK(FarthestPointSampling(line.data(), line.size(), 0, 0).empty());
+    CHECK(FarthestPointSampling(line.data(), 0, 10, 0).empty());
+
+    return test_result();
+}
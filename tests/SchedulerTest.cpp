@@ -0,0 +1,162 @@
+#include "Test.hpp"
+
+#include "Random.hpp"
+#include "Scheduler.hpp"
+
+// Holds the only worker of a scheduler until released, so jobs submitted
+// meanwhile queue up and run in the order the scheduler picks.
+struct Blocker
+{
+    std::atomic<bool> started;
+    std::atomic<bool> released;
+    Scheduler::JobHandle job;
+
+    Blocker(Scheduler& scheduler, const uint32_t tenant) :
+        started(false),
+        released(false)
+    {
+        job = scheduler.Submit(tenant, Priority::Normal, 1, [this](uint32_t)
+        {
+            started = true;
+            while (!released)
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+    }
+};
+
+// Order chunks ran in, as the tenant of each.
+struct RunLog
+{
+    std::mutex mutex;
+    std::vector<uint32_t> order;
+
+    Scheduler::ChunkJob Record(const uint32_t id)
+    {
+        return [this, id](uint32_t)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+        };
+    }
+};
+
+int main()
+{
+    // Interactive chunks go ahead of bulk chunks queued before them.
+    {
+        Scheduler scheduler(1);
+        const uint32_t tenant = scheduler.AddTenant();
+        RunLog log;
+
+        Blocker blocker(scheduler, tenant);
+        const Scheduler::JobHandle bulk = scheduler.Submit(tenant, Priority::Bulk, 5, log.Record(0));
+        const Scheduler::JobHandle interactive = scheduler.Submit(tenant, Priority::Interactive, 3, log.Record(1));
+        blocker.released = true;
+
+        scheduler.Wait(bulk);
+        scheduler.Wait(interactive);
+        CHECK(log.order == std::vector<uint32_t>({ 1, 1, 1, 0, 0, 0, 0, 0 }));
+    }
+
+    // Tenants of the same priority share chunks by weight.
+    {
+        Scheduler scheduler(1);
+        const uint32_t other = scheduler.AddTenant();
+        const uint32_t light = scheduler.AddTenant(1);
+        const uint32_t heavy = scheduler.AddTenant(3);
+        RunLog log;
+
+        Blocker blocker(scheduler, other);
+        const Scheduler::JobHandle a = scheduler.Submit(light, Priority::Bulk, 40, log.Record(light));
+        const Scheduler::JobHandle b = scheduler.Submit(heavy, Priority::Bulk, 40, log.Record(heavy));
+        blocker.released = true;
+
+        scheduler.Wait(a);
+        scheduler.Wait(b);
+        CHECK(log.order.size() == 80);
+
+        // While both have work, three heavy chunks to each light one.
+        const auto heavy_runs = std::count(log.order.begin(), log.order.begin() + 40, heavy);
+        CHECK(heavy_runs >= 29 && heavy_runs <= 31);
+    }
+
+    // Cancelling drops chunks not yet started, and Wait still returns.
+    {
+        Scheduler scheduler(1);
+        const uint32_t tenant = scheduler.AddTenant();
+        CancelToken cancel;
+        std::atomic<uint32_t> runs(0);
+
+        const Scheduler::JobHandle job = scheduler.Submit(tenant, Priority::Bulk, 100, [&](uint32_t)
+        {
+            runs++;
+            cancel.Cancel();
+        },
+        &cancel);
+
+        scheduler.Wait(job);
+        CHECK(scheduler.IsDone(job));
+        CHECK(runs == 1);
+    }
+
+    // Unknown tenants are refused.
+    {
+        Scheduler scheduler(1);
+        const uint32_t tenant = scheduler.AddTenant();
+        const Scheduler::JobHandle job = scheduler.Submit(tenant + 1, Priority::Bulk, 4, [](uint32_t) {});
+        CHECK(!job);
+        CHECK(scheduler.IsDone(job));
+        scheduler.Wait(job);
+
+        Grid grid(0.5f, 1 << 8, vec3(16.0f));
+        const vec3 point(1.0f);
+        CHECK(!ScheduledBuild(scheduler, tenant + 1, grid, &point, 1));
+        CHECK(grid.Size() == 0);
+    }
+
+    // ScheduledBuild gives the same grid as Build, over several rounds of
+    // chunks per slice.
+    {
+        concurrent_threads_limit() = 3;
+        Scheduler scheduler(4);
+        const uint32_t tenant = scheduler.AddTenant();
+
+        const size_t count = 10 * scheduled_chunk_points + 123;
+        std::vector<vec3> positions(count);
+        GenerateUniformPoints(positions.data(), count, 14, vec3(0.0f), vec3(10.0f));
+
+        const size_t counts[] = { count, 1000, 0 };
+        for (const size_t n : counts)
+        {
+            Grid reference(0.5f, 1 << 12, vec3(16.0f));
+            reference.Build(positions.data(), n);
+
+            Grid grid(0.5f, 1 << 12, vec3(16.0f));
+            CHECK(ScheduledBuild(scheduler, tenant, grid, positions.data(), n));
+            CHECK(grid.Size() == n);
+
+            bool same = grid.Size() == n;
+            for (uint32_t b = 0; same && b <= grid.bucket_count; b++)
+            {
+                same = grid.buckets_start[b] == reference.buckets_start[b];
+            }
+            for (size_t k = 0; same && k < n; k++)
+            {
+                same =
+                    grid.positions[k] == reference.positions[k] &&
+                    grid.bucket_ids[k] == reference.bucket_ids[k] &&
+                    grid.indices[k] == reference.indices[k];
+            }
+            CHECK(same);
+        }
+    }
+
+    return test_result();
+}
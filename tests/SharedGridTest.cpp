@@ -0,0 +1,134 @@
+#include "Test.hpp"
+
+#include "Random.hpp"
+#include "SharedGrid.hpp"
+
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+int main()
+{
+    // Shared grids are POSIX only.
+    return 0;
+}
+
+#else
+
+// Same grid, answering queries the same way.
+static bool same_grid(const GridView& a, const GridView& b, const std::vector<vec3>& queries)
+{
+    bool same =
+        a.Size() == b.Size() &&
+        a.bucket_count == b.bucket_count &&
+        a.cell_size == b.cell_size &&
+        a.bounds == b.bounds;
+
+    for (uint32_t k = 0; same && k <= a.bucket_count; k++)
+    {
+        same = a.buckets_start[k] == b.buckets_start[k];
+    }
+    for (size_t i = 0; same && i < a.Size(); i++)
+    {
+        same = a.positions[i] == b.positions[i] && a.indices[i] == b.indices[i];
+    }
+    for (size_t i = 0; same && i < queries.size(); i++)
+    {
+        const Nearest x = a.FindNearest(queries[i], ~0u);
+        const Nearest y = b.FindNearest(queries[i], ~0u);
+        same = x.found == y.found && x.index == y.index && x.distance == y.distance;
+    }
+    return same;
+}
+
+// Places raw grid file bytes in a segment, as a broken publisher might.
+static bool publish_bytes(const char* name, const std::vector<uint8_t>& bytes)
+{
+    const int segment = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (segment < 0)
+    {
+        return false;
+    }
+    const bool written =
+        write(segment, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+    close(segment);
+    return written;
+}
+
+int main()
+{
+    const std::string name = "/nnsearch_test_" + std::to_string(getpid());
+    const size_t count = 20000;
+
+    std::vector<vec3> positions(count);
+    GenerateUniformPoints(positions.data(), count, 11, vec3(0.0f), vec3(10.0f));
+
+    std::vector<vec3> queries(1000);
+    GenerateUniformPoints(queries.data(), queries.size(), 12, vec3(0.0f), vec3(10.0f));
+
+    Grid grid(0.5f, 1 << 12, vec3(16.0f));
+    grid.Build(positions.data(), count);
+
+    UnlinkSharedGrid(name.c_str());
+    CHECK(PublishSharedGrid(name.c_str(), grid));
+    // Names are not reused until unlinked.
+    CHECK(!PublishSharedGrid(name.c_str(), grid));
+
+    {
+        SharedGrid shared(name.c_str());
+        CHECK(shared.IsOpen());
+        CHECK(shared.IsOpen() && same_grid(grid, shared, queries));
+    }
+
+    // Another process sees the same grid.
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        SharedGrid shared(name.c_str());
+        _exit(shared.IsOpen() && same_grid(grid, shared, queries) ? 0 : 1);
+    }
+
+    int status = -1;
+    CHECK(child > 0 && waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // Attached grids outlive the name.
+    {
+        SharedGrid shared(name.c_str());
+        CHECK(UnlinkSharedGrid(name.c_str()));
+        CHECK(shared.IsOpen() && same_grid(grid, shared, queries));
+
+        SharedGrid gone(name.c_str());
+        CHECK(!gone.IsOpen());
+    }
+
+    // A corrupt bucket directory is refused on attach.
+    const char* path = "SharedGridTest.nngf";
+    CHECK(WriteGridFile(path, grid));
+    std::vector<uint8_t> bytes = test_read_file(path);
+    std::remove(path);
+
+    const GridFileHeader header = MakeGridFileHeader(grid);
+    CHECK(bytes.size() == GridFileSize(header));
+
+    const uint32_t backwards = 0xffffffff;
+    std::memcpy(&bytes[header.buckets_offset + 10 * sizeof(uint32_t)], &backwards, 4);
+
+    CHECK(publish_bytes(name.c_str(), bytes));
+    {
+        SharedGrid shared(name.c_str());
+        CHECK(!shared.IsOpen());
+    }
+    UnlinkSharedGrid(name.c_str());
+
+    return test_result();
+}
+
+#endif
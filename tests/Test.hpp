@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/* Tests */
+
+// Each test is an executable returning non zero on failure. CHECK reports
+// and counts a failed condition without stopping, so one run shows every
+// failure.
+
+inline uint32_t& test_failures()
+{
+    static uint32_t failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            test_failures()++; \
+        } \
+    } \
+    while (0)
+
+inline int test_result()
+{
+    if (test_failures() > 0)
+    {
+        std::fprintf(stderr, "%u checks failed\n", test_failures());
+        return 1;
+    }
+    return 0;
+}
+
+/* Files */
+
+inline std::vector<uint8_t> test_read_file(const char* path)
+{
+    std::vector<uint8_t> bytes;
+    FILE* file = std::fopen(path, "rb");
+    if (file)
+    {
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + n);
+        }
+        std::fclose(file);
+    }
+    return bytes;
+}
+
+// Writes 'bytes' with 'value' stored at 'offset', for corrupt file tests.
+template <typename T>
+inline void test_write_patched(
+    const char* path,
+    const std::vector<uint8_t>& bytes,
+    const size_t offset,
+    const T value)
+{
+    FILE* file = std::fopen(path, "wb");
+    if (file)
+    {
+        const size_t end = std::min(offset + sizeof(value), bytes.size());
+        std::fwrite(bytes.data(), 1, std::min(offset, bytes.size()), file);
+        std::fwrite(&value, 1, end > offset ? end - offset : 0, file);
+        std::fwrite(bytes.data() + end, 1, bytes.size() - end, file);
+        std::fclose(file);
+    }
+}
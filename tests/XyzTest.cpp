@@ -0,0 +1,113 @@
+#include "Test.hpp"
+
+#include "XyzReader.hpp"
+
+#include <string>
+
+static void write_text(const char* path, const std::string& text)
+{
+    std::FILE* file = std::fopen(path, "wb");
+    if (file)
+    {
+        std::fwrite(text.data(), 1, text.size(), file);
+        std::fclose(file);
+    }
+}
+
+// Whether 'grid' holds exactly 'expected', by input index.
+static bool holds(const Grid& grid, const std::vector<vec3>& expected)
+{
+    bool same = grid.Size() == expected.size();
+    for (size_t k = 0; same && k < grid.Size(); k++)
+    {
+        same =
+            grid.indices[k] < expected.size() &&
+            grid.positions[k] == expected[grid.indices[k]] &&
+            grid.Bucket(grid.positions[k]) == grid.bucket_ids[k];
+    }
+    return same;
+}
+
+int main()
+{
+    const char* path = "XyzTest.xyz";
+
+    // Comments, headers, blank lines and rows without three numbers are
+    // skipped, CRLF and any of the delimiters split rows.
+    write_text(path,
+        "# exported cloud\n"
+        "x,y,z\n"
+        "1.5 2.5 3.5\r\n"
+        "\n"
+        "\r\n"
+        "-1e1,2,+3.25\r\n"
+        "7 8\n"
+        "1 2 abc\n"
+        "1 2 3abc\n"
+        "4;5;6 extra\n"
+        "0.5\t0.25\t1e-1");
+
+    {
+        Grid grid(0.5f, 1 << 8, vec3(16.0f));
+        CHECK(LoadXyz(path, grid));
+        CHECK(holds(grid, {
+            vec3(1.5f, 2.5f, 3.5f),
+            vec3(-10.0f, 2.0f, 3.25f),
+            vec3(4.0f, 5.0f, 6.0f),
+            vec3(0.5f, 0.25f, 0.1f) }));
+    }
+
+    // Columns picked by options, other columns may hold anything.
+    write_text(path,
+        "id name z y x\n"
+        "0 a 3 2 1\r\n"
+        "1 b 6 5 4\r\n");
+
+    {
+        XyzOptions options;
+        options.x_column = 4;
+        options.y_column = 3;
+        options.z_column = 2;
+
+        Grid grid(0.5f, 1 << 8, vec3(16.0f));
+        CHECK(LoadXyz(path, grid, options));
+        CHECK(holds(grid, { vec3(1.0f, 2.0f, 3.0f), vec3(4.0f, 5.0f, 6.0f) }));
+    }
+
+    // Enough lines for several slices, split only at line ends.
+    concurrent_threads_limit() = 4;
+    {
+        std::vector<vec3> expected(30000);
+        std::string text;
+        char line[64];
+
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            expected[i] = vec3(i % 97 * 0.125f, i % 89 * 0.25f, i % 83 * 0.0625f);
+            std::snprintf(line, sizeof(line), "%g %g %g\n", expected[i].x, expected[i].y, expected[i].z);
+            text += line;
+        }
+        write_text(path, text);
+
+        Grid grid(0.5f, 1 << 12, vec3(32.0f));
+        CHECK(LoadXyz(path, grid));
+        CHECK(holds(grid, expected));
+    }
+
+    // An empty file is an empty cloud, a missing one an error.
+    write_text(path, "");
+    {
+        Grid grid(0.5f, 1 << 8, vec3(16.0f));
+        CHECK(LoadXyz(path, grid));
+        CHECK(grid.Size() == 0);
+        CHECK(grid.buckets_start != nullptr && grid.buckets_start[grid.bucket_count] == 0);
+    }
+
+    std::remove(path);
+    {
+        Grid grid(0.5f, 1 << 8, vec3(16.0f));
+        CHECK(!LoadXyz(path, grid));
+    }
+
+    return test_result();
+}